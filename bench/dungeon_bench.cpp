@@ -0,0 +1,246 @@
+// Бенчмарки горячих путей симуляции на 1e2, 1e4 и 1e6 NPC (Google Benchmark).
+// Все данные строятся от фиксированного зерна, поэтому прогоны сравнимы.
+// JSON для сравнения версий:
+//   dungeon_bench --benchmark_out=bench.json --benchmark_out_format=json
+#include "../include/dungeon.h"
+#include "../include/factory.h"
+#include "../include/npc_arena.h"
+#include "../include/range_kernel.h"
+#include "../include/spatial_grid.h"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const unsigned SEED = 42;
+const double CELL_SIZE = 30;  // Макс. дистанция убийства, как в Dungeon
+
+// Плотность как в игре: 50 NPC на 100x100
+double worldSide(size_t count) {
+    return std::max(100.0, std::sqrt(count / 50.0) * 100.0);
+}
+
+std::vector<std::shared_ptr<NPC>> makeNPCs(size_t count, double side) {
+    NPCFactory::setSeed(SEED);
+    return NPCFactory::createMany(count, SpawnRegion{0, 0, side, side});
+}
+
+void setItems(benchmark::State& state) {
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()) * state.range(0));
+}
+
+// Шаг всех NPC с обновлением сетки (границы мира по умолчанию, 100x100)
+void BM_NPCMove(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    auto npcs = makeNPCs(count, 100);
+    SpatialGrid grid(100, 100, CELL_SIZE);
+    for (auto& npc : npcs) grid.insert(npc.get());
+    std::mt19937 gen(SEED);
+
+    for (auto _ : state) {
+        for (auto& npc : npcs) {
+            npc->move(gen);
+        }
+    }
+    grid.clear();
+    setItems(state);
+}
+
+void BM_DistanceTo(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    auto npcs = makeNPCs(count, worldSide(count));
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (size_t i = 0; i + 1 < count; ++i) {
+            sum += npcs[i]->distanceTo(*npcs[i + 1]);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    setItems(state);
+}
+
+// Поиск всех пар в радиусе атаки через сетку и inRangeMask
+void BM_EncounterDetection(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const double side = worldSide(count);
+    auto npcs = makeNPCs(count, side);
+    SpatialGrid grid(side, side, CELL_SIZE);
+    for (auto& npc : npcs) grid.insert(npc.get());
+
+    for (auto _ : state) {
+        size_t pairs = 0;
+        for (const auto& npc : npcs) {
+            if (!canTypeAttackAny(npc->getTypeTag())) continue;
+            grid.forEachInRange(npc->getX(), npc->getY(), npc->getKillDistance(), [&](NPC* other) {
+                if (other != npc.get() && npc->canAttack(other)) pairs++;
+            });
+        }
+        benchmark::DoNotOptimize(pairs);
+    }
+    grid.clear();
+    setItems(state);
+}
+
+// Бой дракона с быком: броски, смерть, счетчики и событие в шину
+void BM_ProcessFight(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    Dungeon dungeon;
+    // Шина не запущена: события отбрасываются, а не копятся
+    dungeon.setEventOverflowPolicy(OverflowPolicy::Drop);
+    std::vector<FightTask> tasks(count);
+    std::mt19937 gen(SEED);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (size_t i = 0; i < count; ++i) {
+            tasks[i].attacker = NPCFactory::createNPC(NPCType::Dragon, 0, 0, "Дракон");
+            tasks[i].defender = NPCFactory::createNPC(NPCType::Bull, 1, 1, "Бык");
+        }
+        state.ResumeTiming();
+        for (auto& task : tasks) {
+            dungeon.resolveFight(task, gen);
+        }
+    }
+    setItems(state);
+}
+
+void BM_CreateRandomNPC(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    NPCFactory::setSeed(SEED);
+    std::vector<std::shared_ptr<NPC>> npcs;
+    npcs.reserve(count);
+
+    for (auto _ : state) {
+        npcs.clear();
+        for (size_t i = 0; i < count; ++i) {
+            npcs.push_back(NPCFactory::createRandomNPC(static_cast<double>(i % 100), static_cast<double>(i / 100 % 100)));
+        }
+        benchmark::DoNotOptimize(npcs.data());
+    }
+    setItems(state);
+}
+
+// То же пачкой в арене (как Dungeon::spawnRandomNPCs)
+void BM_CreateManyArena(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    NPCFactory::setSeed(SEED);
+
+    for (auto _ : state) {
+        NPCArena arena;
+        auto npcs = NPCFactory::createMany(count, SpawnRegion{}, &arena);
+        benchmark::DoNotOptimize(npcs.data());
+        state.PauseTiming();
+        npcs.clear();
+        state.ResumeTiming();
+    }
+    setItems(state);
+}
+
+std::string benchFile(const char* name) {
+    return std::string("dungeon_bench_") + name + ".txt";
+}
+
+size_t fileSize(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+void BM_SaveToFile(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    NPCFactory::setSeed(SEED);
+    Dungeon dungeon;
+    dungeon.spawnRandomNPCs(count);
+    const std::string path = benchFile("save");
+
+    for (auto _ : state) {
+        dungeon.saveToFile(path);
+    }
+    setItems(state);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * fileSize(path)));
+    std::remove(path.c_str());
+}
+
+void BM_LoadFromFile(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    NPCFactory::setSeed(SEED);
+    const std::string path = benchFile("load");
+    {
+        Dungeon source;
+        source.spawnRandomNPCs(count);
+        source.saveToFile(path);
+    }
+    Dungeon dungeon;
+
+    for (auto _ : state) {
+        dungeon.loadFromFile(path);
+    }
+    setItems(state);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * fileSize(path)));
+    std::remove(path.c_str());
+}
+
+// Наблюдатель, который только считает события
+class CountingObserver : public Observer {
+public:
+    std::atomic<size_t> events{0};
+    void onFight(NPCRef, NPCRef, bool) override { events++; }
+    void onMove(NPCRef, double, double) override { events++; }
+    void onDie(NPCRef) override { events++; }
+};
+
+// Путь события от публикации до наблюдателя через EventBus
+void BM_ObserverDispatch(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    EventBus bus;
+    auto observer = std::make_shared<CountingObserver>();
+    bus.addObserver(observer);
+    bus.start();
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            NPCRef npc{static_cast<std::uint32_t>(i), 0};
+            if (i % 4 == 0) {
+                bus.onFight(npc, NPCRef{static_cast<std::uint32_t>(i + 1), 0}, false);
+            } else {
+                bus.onMove(npc, static_cast<double>(i % 100), 0);
+            }
+        }
+        bus.flush();
+    }
+    bus.stop();
+    setItems(state);
+}
+
+void sizes(benchmark::internal::Benchmark* bench) {
+    bench->Arg(100)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_NPCMove)->Apply(sizes);
+BENCHMARK(BM_DistanceTo)->Apply(sizes);
+BENCHMARK(BM_EncounterDetection)->Apply(sizes);
+BENCHMARK(BM_ProcessFight)->Apply(sizes);
+BENCHMARK(BM_CreateRandomNPC)->Apply(sizes);
+BENCHMARK(BM_CreateManyArena)->Apply(sizes);
+BENCHMARK(BM_SaveToFile)->Apply(sizes);
+BENCHMARK(BM_LoadFromFile)->Apply(sizes);
+BENCHMARK(BM_ObserverDispatch)->Apply(sizes);
+
+int main(int argc, char** argv) {
+    // Условия прогона попадают в раздел context JSON-отчета
+    benchmark::AddCustomContext("seed", std::to_string(SEED));
+    benchmark::AddCustomContext("range_kernel", rangeKernelName(activeRangeKernel()));
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
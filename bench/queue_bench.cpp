@@ -0,0 +1,127 @@
+// Сравнение очереди задач боев: прежняя std::queue под мьютексом с
+// notify_one на каждую задачу против lock-free кольца MPMCQueue с
+// пакетной вставкой и одним пробуждением на пачку.
+#include "../include/mpmc_queue.h"
+#include "../include/fight_pool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t TOTAL_TASKS = 1 << 21;
+const size_t BATCH_SIZE = 64;
+
+// Прежняя схема из Dungeon::movementWorker/fightWorker
+double runMutexQueue(size_t producers) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::queue<FightTask> queue;
+    size_t perProducer = TOTAL_TASKS / producers;
+    size_t total = perProducer * producers;
+
+    auto start = Clock::now();
+
+    std::thread consumer([&]() {
+        for (size_t done = 0; done < total; ++done) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return !queue.empty(); });
+            FightTask task = std::move(queue.front());
+            queue.pop();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < perProducer; ++i) {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push(FightTask{});
+                cv.notify_one();
+            }
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+    consumer.join();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Кольцо с пакетной вставкой: одно пробуждение на пачку
+double runRingQueue(size_t producers) {
+    MPMCQueue<FightTask> queue(65536);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> sleeping(false);
+    size_t perProducer = TOTAL_TASKS / producers;
+    size_t total = perProducer * producers;
+
+    auto start = Clock::now();
+
+    std::thread consumer([&]() {
+        FightTask task;
+        for (size_t done = 0; done < total;) {
+            if (queue.tryPop(task)) {
+                done++;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping = true;
+            cv.wait(lock, [&]() { return queue.sizeApprox() > 0; });
+            sleeping = false;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            std::vector<FightTask> batch(BATCH_SIZE);
+            for (size_t sent = 0; sent < perProducer;) {
+                size_t count = std::min(BATCH_SIZE, perProducer - sent);
+                size_t pushed = 0;
+                while (pushed < count) {
+                    pushed += queue.pushBatch(batch.data() + pushed, count - pushed);
+                    if (pushed < count) std::this_thread::yield();
+                }
+                sent += count;
+                if (sleeping) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    cv.notify_one();
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) thread.join();
+    consumer.join();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const size_t producerCounts[] = {1, 4, 16};
+
+    std::cout << "Задач: " << TOTAL_TASKS << ", пачка: " << BATCH_SIZE << "\n";
+    std::cout << "производители   мьютекс, мс   кольцо, мс   ускорение\n";
+
+    for (size_t producers : producerCounts) {
+        double mutexMs = runMutexQueue(producers);
+        double ringMs = runRingQueue(producers);
+        std::cout << std::setw(13) << producers
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(14) << mutexMs
+                  << std::setw(13) << ringMs
+                  << std::setw(11) << std::setprecision(2) << mutexMs / ringMs << "x\n";
+    }
+
+    return 0;
+}
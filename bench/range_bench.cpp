@@ -0,0 +1,101 @@
+// Проверка радиуса атаки для блоков кандидатов: прежнее сравнение
+// sqrt(pow + pow) <= killDistance по одной паре против inRangeMask
+// (квадраты расстояний) на каждом доступном ядре.
+#include "../include/range_kernel.h"
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t CANDIDATES = 1 << 16;
+const size_t ATTACKERS = 256;
+
+// Маска по прежней формуле NPC::distanceTo
+std::uint64_t sqrtMask(double x, double y, double radius, const double* xs, const double* ys, size_t count) {
+    std::uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (std::sqrt(std::pow(xs[i] - x, 2) + std::pow(ys[i] - y, 2)) <= radius) {
+            mask |= std::uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
+struct Result {
+    double nsPerCandidate;
+    std::uint64_t hits;
+    std::uint64_t checksum;  // Сумма масок с весами - для сверки ядер
+};
+
+template <typename MaskFn>
+Result run(const std::vector<double>& ax, const std::vector<double>& ay,
+           const std::vector<double>& xs, const std::vector<double>& ys, MaskFn&& maskFn) {
+    Result result{0, 0, 0};
+    auto start = Clock::now();
+    for (size_t a = 0; a < ax.size(); ++a) {
+        for (size_t base = 0; base < xs.size(); base += RANGE_BLOCK) {
+            size_t block = std::min(RANGE_BLOCK, xs.size() - base);
+            std::uint64_t mask = maskFn(ax[a], ay[a], xs.data() + base, ys.data() + base, block);
+            result.hits += std::bitset<64>(mask).count();
+            result.checksum = result.checksum * 31 + mask;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    result.nsPerCandidate = ns / (static_cast<double>(ax.size()) * xs.size());
+    return result;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> posDist(0, 100);
+
+    // Целые координаты, как у NPC в игре, плюс дробные
+    std::vector<double> xs(CANDIDATES), ys(CANDIDATES);
+    for (size_t i = 0; i < CANDIDATES; ++i) {
+        xs[i] = i % 2 ? std::floor(posDist(gen)) : posDist(gen);
+        ys[i] = i % 2 ? std::floor(posDist(gen)) : posDist(gen);
+    }
+    std::vector<double> ax(ATTACKERS), ay(ATTACKERS);
+    for (size_t i = 0; i < ATTACKERS; ++i) {
+        ax[i] = std::floor(posDist(gen));
+        ay[i] = std::floor(posDist(gen));
+    }
+
+    std::cout << "Ядро по умолчанию: " << rangeKernelName(activeRangeKernel()) << "\n";
+    std::cout << " радиус  вариант        нс/кандидат       попаданий\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    for (int radius : {10, 30}) {
+        double r2 = static_cast<double>(radius) * radius;
+        Result reference = run(ax, ay, xs, ys, [&](double x, double y, const double* px, const double* py, size_t n) {
+            return sqrtMask(x, y, radius, px, py, n);
+        });
+        std::cout << std::setw(7) << radius << "  " << std::left << std::setw(12) << "sqrt+pow" << std::right
+                  << std::setw(14) << reference.nsPerCandidate
+                  << std::setw(16) << reference.hits << "\n";
+
+        for (RangeKernel kernel : {RangeKernel::Scalar, RangeKernel::SSE2, RangeKernel::AVX2}) {
+            if (!rangeKernelSupported(kernel)) continue;
+            Result result = run(ax, ay, xs, ys, [&](double x, double y, const double* px, const double* py, size_t n) {
+                return inRangeMask(kernel, x, y, r2, px, py, n);
+            });
+            std::cout << std::setw(7) << radius << "  " << std::left << std::setw(12) << rangeKernelName(kernel)
+                      << std::right << std::setw(14) << result.nsPerCandidate << std::setw(16) << result.hits;
+            if (result.checksum != reference.checksum) {
+                std::cout << "  РАСХОЖДЕНИЕ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Масштабирование режима регионов: один и тот же мир в 1, 2, 4 и 8
+// процессах (region.h). Ускорение считается от одного региона; доля обмена -
+// время обмена с соседями в самом медленном регионе. Без аргументов -
+// 200000 NPC в мире 8000x8000 (плотность обычной игры), 20 тиков.
+// Аргументы: [NPC] [тиков] [ширина]
+#include "../include/region.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    RegionConfig config;
+    config.world.spawnCount = argc > 1 ? std::stoull(argv[1]) : 200000;
+    config.ticks = argc > 2 ? std::stoull(argv[2]) : 20;
+    config.world.width = argc > 3 ? std::stod(argv[3]) : 8000;
+    config.world.height = config.world.width;
+    config.seeded = true;
+    config.seed = 42;
+    config.deterministic = true;
+
+    const size_t regionCounts[] = {1, 2, 4, 8};
+
+    std::cout << "NPC: " << config.world.spawnCount << ", мир " << config.world.width << "x"
+              << config.world.height << ", тиков: " << config.ticks << "\n";
+    std::cout << "регионы   тиков/с   ускорение   обмен, %   копий/тик   сумма\n";
+
+    double baseline = 0;
+    for (size_t regions : regionCounts) {
+        config.regions = regions;
+        RegionReport report;
+        std::string error;
+        if (!runRegions(config, report, error)) {
+            std::cerr << regions << " регионов: " << error << "\n";
+            return 1;
+        }
+        if (regions == 1) baseline = report.ticksPerSecond;
+
+        double exchangeShare = 0;
+        std::uint64_t copies = 0;
+        for (const RegionStats& region : report.regions) {
+            if (region.wallSeconds > 0) {
+                exchangeShare = std::max(exchangeShare, region.exchangeSeconds / region.wallSeconds);
+            }
+            copies += region.ghostsSent;
+        }
+
+        std::cout << std::setw(7) << regions
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(10) << report.ticksPerSecond
+                  << std::setw(12) << (baseline > 0 ? report.ticksPerSecond / baseline : 0)
+                  << std::setprecision(1)
+                  << std::setw(11) << exchangeShare * 100
+                  << std::setw(12) << (report.ticks ? copies / report.ticks : 0)
+                  << "   " << std::hex << report.checksum << std::dec << "\n";
+    }
+    return 0;
+}
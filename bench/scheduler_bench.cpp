@@ -0,0 +1,67 @@
+// Планировщик сопрограмм (scheduler.h) на большом числе поведений:
+// каждое STEPS раз засыпает на 1..50 мс и делает шаг. Печатает время,
+// пробуждения в секунду и среднее опоздание таймера относительно срока.
+// Аргументы: [наибольшее число задач (1000000)] [потоков пула (2)]
+#include "../include/scheduler.h"
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Clock = Scheduler::Clock;
+
+const int STEPS = 5;
+
+struct Counters {
+    std::atomic<std::uint64_t> steps{0};
+    std::atomic<std::uint64_t> lateNanoseconds{0};
+};
+
+Task behaviour(Scheduler& scheduler, Counters& counters, unsigned seed) {
+    std::minstd_rand gen(seed);
+    std::uniform_int_distribution<int> delay(1, 50);
+    for (int step = 0; step < STEPS; ++step) {
+        auto when = Clock::now() + std::chrono::milliseconds(delay(gen));
+        co_await scheduler.sleepUntil(when);
+        auto late = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - when).count();
+        counters.lateNanoseconds.fetch_add(static_cast<std::uint64_t>(late), std::memory_order_relaxed);
+        counters.steps.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t maxTasks = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    const size_t threads = argc > 2 ? std::stoull(argv[2]) : 2;
+
+    std::cout << "Потоков пула: " << threads << ", шагов на задачу: " << STEPS << "\n";
+    std::cout << "      задачи    время, с   пробуждений/с   опоздание, мс\n";
+
+    for (size_t tasks = 10000; tasks <= maxTasks; tasks *= 10) {
+        Counters counters;
+        Scheduler scheduler(threads);
+        auto start = Clock::now();
+        for (size_t i = 0; i < tasks; ++i) {
+            scheduler.spawn(behaviour(scheduler, counters, static_cast<unsigned>(i + 1)));
+        }
+        while (scheduler.getLiveTasks() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        scheduler.stop();
+
+        std::uint64_t steps = counters.steps.load();
+        std::cout << std::setw(12) << tasks
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << seconds
+                  << std::setw(16) << std::setprecision(0) << scheduler.getResumed() / seconds
+                  << std::setw(16) << std::setprecision(3)
+                  << (steps ? counters.lateNanoseconds.load() / 1e6 / steps : 0) << "\n";
+    }
+    return 0;
+}
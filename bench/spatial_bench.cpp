@@ -0,0 +1,89 @@
+// Сравнение поиска встреч через SpatialGrid и полного перебора O(N^2).
+// Плотность NPC фиксирована (как в игре: 50 NPC на 100x100),
+// поэтому размер мира растет вместе с числом NPC.
+#include "../include/spatial_grid.h"
+#include "../include/factory.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Число пар (атакующий, цель) в радиусе атаки полным перебором
+size_t bruteForce(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    size_t pairs = 0;
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        for (size_t j = 0; j < npcs.size(); ++j) {
+            if (i == j) continue;
+            if (npcs[i]->distanceTo(*npcs[j]) <= npcs[i]->getKillDistance()) pairs++;
+        }
+    }
+    return pairs;
+}
+
+size_t gridSearch(const SpatialGrid& grid, const std::vector<std::shared_ptr<NPC>>& npcs) {
+    size_t pairs = 0;
+    for (const auto& npc : npcs) {
+        grid.forEachInRange(npc->getX(), npc->getY(), npc->getKillDistance(), [&](NPC* other) {
+            if (other != npc.get()) pairs++;
+        });
+    }
+    return pairs;
+}
+
+} // namespace
+
+int main() {
+    const size_t sizes[] = {1000, 5000, 20000, 100000, 1000000};
+    const size_t BRUTE_FORCE_LIMIT = 20000;
+
+    std::mt19937 gen(42);
+
+    std::cout << "       NPC           пар     сетка, мс   перебор, мс\n";
+
+    for (size_t n : sizes) {
+        double side = std::sqrt(n / 50.0) * 100.0;
+        std::uniform_real_distribution<> posDist(0, side);
+
+        std::vector<std::shared_ptr<NPC>> npcs;
+        npcs.reserve(n);
+        SpatialGrid grid(side, side, 30);
+        for (size_t i = 0; i < n; ++i) {
+            npcs.push_back(NPCFactory::createRandomNPC(posDist(gen), posDist(gen)));
+            grid.insert(npcs.back().get());
+        }
+
+        auto start = Clock::now();
+        size_t gridPairs = gridSearch(grid, npcs);
+        double gridMs = elapsedMs(start);
+
+        std::cout << std::setw(10) << n << std::setw(14) << gridPairs
+                  << std::setw(14) << std::fixed << std::setprecision(2) << gridMs;
+
+        if (n <= BRUTE_FORCE_LIMIT) {
+            start = Clock::now();
+            size_t brutePairs = bruteForce(npcs);
+            double bruteMs = elapsedMs(start);
+            std::cout << std::setw(14) << bruteMs;
+            if (brutePairs != gridPairs) {
+                std::cout << "  РАСХОЖДЕНИЕ: " << brutePairs;
+            }
+        } else {
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << "\n";
+
+        grid.clear();
+    }
+
+    return 0;
+}
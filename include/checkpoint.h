@@ -0,0 +1,130 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "world_snapshot.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// Файл контрольных точек долгого прогона.
+//
+// Заголовок "DCKP" + uint16 версия + uint16 резерв, затем кадры.
+// Первый кадр всегда полный (все NPC), следующие - разностные: только
+// NPC, изменившиеся с прошлой точки, и номера удаленных уплотнением.
+// Раз в fullEvery точек файл целиком переписывается полным кадром через
+// временный файл и rename, поэтому он не растет без границ и на диске
+// всегда лежит целый файл.
+//
+// Кадр:
+//   uint32 длина тела, тело, uint64 хеш тела
+//   тело: uint8 вид (0 - полный, 1 - разностный), uint64 тик,
+//         uint32 зерно, uint8 воспроизводимый режим, uint32 следующий id,
+//         uint64 боев, uint64 убийств[тип][тип], uint64 убрано уплотнением,
+//         uint64 смертей текущего тика, uint32 длина истории смертей,
+//         uint64 смертей за каждый тик истории (от старых к новым),
+//         uint32 число записей NPC, записи, uint32 число удаленных, их id
+//   запись: uint32 id, uint8 тип, uint8 флаги (1 - жив, 2 - есть имя),
+//           double x, double y, [uint16 длина, байты имени]
+// Имя пишется при первом появлении NPC в файле. Кадр, оборванный
+// падением процесса (короткий или с неверным хешем), при чтении
+// отбрасывается вместе со всем, что после него.
+const char CHECKPOINT_MAGIC[4] = {'D', 'C', 'K', 'P'};
+const std::uint16_t CHECKPOINT_VERSION = 2;
+
+// Состояние подземелья, которого нет в самих NPC
+struct CheckpointMeta {
+    std::uint32_t seed = 0;
+    bool deterministic = false;
+    std::uint32_t nextNPCId = 0;
+};
+
+// Мир, восстановленный из файла контрольных точек
+struct CheckpointState {
+    std::uint64_t tick = 0;
+    CheckpointMeta meta;
+    StatsSnapshot stats;  // Заполнены бои и убийства; население - по NPC
+    std::vector<value::NPCValue> npcs;
+    size_t frames = 0;     // Применено кадров
+};
+
+// false, если файла нет или в нем нет ни одного целого полного кадра
+bool readCheckpoint(const std::string& path, CheckpointState& state);
+
+// Пишет контрольные точки в своем потоке.
+// submit только кладет снимок мира в ячейку и будит писателя, поэтому
+// тик не ждет диска. Если писатель не успевает, промежуточные снимки
+// заменяются последним: разность все равно считается от записанного.
+// Неудачная запись (диск полон, rename не прошел) считается в failed и
+// ничего не меняет в известном писателю состоянии; следующая точка тогда
+// пишется полным кадром.
+class Checkpointer {
+private:
+    // Последнее записанное состояние NPC, по id
+    struct Known {
+        bool present = false;
+        bool named = false;  // Имя уже есть в текущем файле
+        std::uint8_t type = 0;
+        bool alive = false;
+        double x = 0, y = 0;
+        std::uint64_t mark = 0;  // Номер точки, в которой NPC видели
+    };
+
+    std::string path;
+    size_t fullEvery;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::shared_ptr<const WorldSnapshot> pending;
+    CheckpointMeta pendingMeta;
+    bool stopping;
+    bool idle;
+    std::condition_variable idleCV;
+
+    // Состояние потока-писателя
+    std::vector<Known> known;
+    std::ofstream out;
+    size_t sinceFull;
+    std::uint64_t mark;
+
+    // Статистика
+    std::atomic<std::uint64_t> written;
+    std::atomic<std::uint64_t> skipped;
+    std::atomic<std::uint64_t> failed;
+    std::atomic<std::uint64_t> bytesWritten;
+    std::atomic<std::uint64_t> lastTick;
+
+    void writerLoop();
+    void writeCheckpoint(const WorldSnapshot& snapshot, const CheckpointMeta& meta);
+    // Записывает готовый кадр; false, если он не попал на диск целиком
+    bool writeFrame(const std::string& frame, bool full);
+
+public:
+    // fullEvery - через сколько точек переписывать файл полным кадром
+    Checkpointer(const std::string& path, size_t fullEvery = 16);
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    void submit(std::shared_ptr<const WorldSnapshot> snapshot, const CheckpointMeta& meta);
+    // Дожидается записи уже отданного снимка
+    void flush();
+    // Записывает отданный снимок и останавливает поток
+    void stop();
+
+    const std::string& getPath() const { return path; }
+    std::uint64_t getWritten() const { return written; }
+    std::uint64_t getSkipped() const { return skipped; }
+    std::uint64_t getFailed() const { return failed; }
+    std::uint64_t getBytesWritten() const { return bytesWritten; }
+    std::uint64_t getLastTick() const { return lastTick; }
+};
+
+#endif
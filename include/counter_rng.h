@@ -0,0 +1,62 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Генератор случайных чисел на счетчике.
+// Поток чисел полностью определяется ключом (зерно, назначение, тик,
+// id NPC, ...), а не историей вызовов, поэтому результат не зависит от
+// того, какой поток и в каком порядке обрабатывает NPC. Каждое число -
+// это хеш splitmix64 от ключа и номера вызова. Назначение (STREAM_*)
+// разводит ключи: ход NPC 0 и бой с защитником 0 иначе совпали бы.
+class CounterRng {
+private:
+    std::uint64_t key;
+    std::uint64_t counter;
+
+public:
+    using result_type = std::uint64_t;
+
+    static const std::uint64_t STREAM_MOVE = 1;   // (тик, id NPC)
+    static const std::uint64_t STREAM_FIGHT = 2;  // (тик, атакующий, защитник)
+
+    static std::uint64_t mix(std::uint64_t z) {
+        z += 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    CounterRng(std::uint64_t seed, std::uint64_t stream, std::uint64_t a, std::uint64_t b = 0, std::uint64_t c = 0)
+        : key(mix(mix(mix(mix(mix(seed) ^ stream) ^ a) ^ b) ^ c)), counter(0) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        return mix(key + (++counter) * 0x9E3779B97F4A7C15ull);
+    }
+
+    // Равномерное целое из [lo, hi]. Не зависит от реализации
+    // std::uniform_int_distribution, поэтому одинаково на всех платформах.
+    int uniform(int lo, int hi) {
+        auto range = static_cast<std::uint64_t>(static_cast<std::int64_t>(hi) - lo + 1);
+        return lo + static_cast<int>(((operator()() >> 32) * range) >> 32);
+    }
+};
+
+// Шаг хеша состояния одного NPC. Общий для Dungeon::stateChecksum и
+// повтора журнала (replay.h), чтобы их суммы можно было сравнивать
+inline std::uint64_t mixNPCState(std::uint64_t hash, std::uint32_t id, double x, double y, bool alive) {
+    std::uint64_t xBits, yBits;
+    std::memcpy(&xBits, &x, sizeof(x));
+    std::memcpy(&yBits, &y, sizeof(y));
+    hash = CounterRng::mix(hash ^ id);
+    hash = CounterRng::mix(hash ^ xBits);
+    hash = CounterRng::mix(hash ^ yBits);
+    return CounterRng::mix(hash ^ (alive ? 1u : 0u));
+}
+
+#endif
@@ -4,6 +4,17 @@
 #include "npc.h"
 #include "factory.h"
 #include "observer.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+#include "fight_pool.h"
+#include "event_bus.h"
+#include "npc_arena.h"
+#include "npc_store.h"
+#include "dungeon_stats.h"
+#include "world_snapshot.h"
+#include "checkpoint.h"
+#include "world_config.h"
+#include "scheduler.h"
 #include <vector>
 #include <memory>
 #include <fstream>
@@ -11,61 +22,320 @@
 #include <shared_mutex>
 #include <atomic>
 #include <condition_variable>
-#include <queue>
 #include <functional>
 #include <thread>
 
-// Структура для задания боя
-struct FightTask {
-    std::shared_ptr<NPC> attacker;
-    std::shared_ptr<NPC> defender;
+// Итоги прогона без отрисовки и пауз
+struct HeadlessReport {
+    std::uint64_t ticks = 0;
+    double wallSeconds = 0;
+    double ticksPerSecond = 0;
+    int fights = 0;
+    size_t alive = 0;
+    size_t total = 0;
+    std::uint64_t checksum = 0;  // Хеш состояния мира (см. Dungeon::stateChecksum)
+    double bytesPerNPC = 0;      // Расход арены на один созданный NPC
+    size_t removed = 0;          // Погибших, убранных уплотнением
+    size_t compactions = 0;
+    double compactionMilliseconds = 0;
+};
+
+// Ссылка на NPC подземелья, переживающая уплотнение.
+// Слот указывает на текущее место NPC, поколение слота растет при каждом
+// его освобождении, поэтому ссылка на удаленного NPC не разрешается
+// в NPC, занявшего тот же слот позже.
+struct NPCHandle {
+    static constexpr std::uint32_t INVALID = 0xFFFFFFFFu;
+
+    std::uint32_t slot = INVALID;
+    std::uint32_t generation = 0;
+
+    bool isValid() const { return slot != INVALID; }
+};
+
+// Откуда шаг движения и снимок мира для карты берут координаты и флаги жизни
+enum class NPCStorage {
+    Objects,  // Из объектов NPC, по указателям из npcs
+    Columns   // Из хранилища столбцами (npc_store.h), которое ведется рядом с npcs
+};
+
+// Итоги одного уплотнения
+struct CompactionReport {
+    size_t removed = 0;         // Удалено погибших NPC
+    size_t remaining = 0;       // Осталось в подземелье
+    size_t bytesReclaimed = 0;  // Освобождено в арене и в массиве npcs
+    double milliseconds = 0;
 };
 
 // Класс для управления подземельем
 class Dungeon {
 private:
+    // Размеры мира, население и дистанции; объявлены раньше сетки,
+    // которая строится по ним
+    WorldConfig config;
+    
+    // Память созданных через spawnRandomNPCs NPC; объявлена раньше npcs,
+    // чтобы освобождаться после них
+    NPCArena arena;
     std::vector<std::shared_ptr<NPC>> npcs;
-    std::vector<std::shared_ptr<Observer>> observers;
+    
+    // Таблица слотов для NPCHandle: слот -> место в npcs и поколение
+    struct HandleSlot {
+        std::uint32_t index;
+        std::uint32_t generation;
+    };
+    static constexpr std::uint32_t FREE_SLOT = 0xFFFFFFFFu;
+    std::vector<HandleSlot> handleSlots;
+    std::vector<std::uint32_t> freeSlots;
+    std::vector<std::uint32_t> npcSlots;  // Параллельно npcs: слот каждого NPC
+    
+    // Хранилище столбцами, индекс - тот же, что в npcs (NPCStorage::Columns).
+    // По нему идут шаг движения и снимок для карты; бои и сетка работают
+    // с объектами. После изменения состава оно перестраивается в начале
+    // следующего тика, а смерти из боев переносятся в него после боев
+    NPCStorage storage;
+    NPCStore columns;
+    bool columnsStale;
+    size_t columnsAlive;  // Живых в columns; не совпадает со stats - были смерти
+    
+    SpatialGrid grid;  // Индекс для поиска соседей, ячейка = макс. дистанция убийства
+    // Наблюдатели подключены к шине: события доставляет ее поток-диспетчер
+    std::shared_ptr<EventBus> eventBus;
     
     // Потокобезопасные структуры
     mutable std::shared_mutex npcsMutex;
-    std::mutex fightQueueMutex;
-    std::condition_variable fightCV;
-    std::queue<FightTask> fightQueue;
     
     // Флаги управления потоками
     std::atomic<bool> running;
-    std::atomic<int> fightCount;
+    DungeonStats stats;  // Население и бои, обновляются по ходу игры
+    std::atomic<std::uint64_t> tick;  // Номер текущего тика движения
+    std::mutex stopMutex;             // stopGame может прийти из main и деструктора
     
-    // Потоки
-    std::thread movementThread;
-    std::thread fightThread;
-    std::thread mainThread;
+    // Параметры партии
+    int gameDurationSeconds;
+    
+    // Сопрограммы тиков движения и карты на небольшом пуле с колесом
+    // таймеров (scheduler.h): ожидание между тиками не держит поток
+    std::unique_ptr<Scheduler> scheduler;
     
     // Генератор случайных чисел для каждого потока
     std::random_device rd;
+    // Если задано зерно, все генераторы подземелья выводятся из него
+    bool seeded;
+    unsigned masterSeed;
+    std::mt19937 seedSource;
+    
+    // Воспроизводимый режим: результат зависит только от зерна,
+    // а не от числа потоков и планировщика
+    bool deterministic;
+    std::uint32_t nextNPCId;
+    
+    // Уплотнение: доля погибших, при которой оно запускается (0 - никогда)
+    double compactDeadFraction;
+    size_t compactMinDead;
+    CompactionReport lastCompaction;
+    
+    // Снимок мира для читателей; публикует тик движения, а в
+    // остановленном подземелье после изменений - первый читатель
+    mutable WorldSnapshotBuffer world;
+    mutable std::atomic<bool> worldDirty;
+    
+    // Фоновые контрольные точки: раз в checkpointEvery тиков
+    std::unique_ptr<Checkpointer> checkpointer;
+    std::uint64_t checkpointEvery;
+    std::uint64_t lastCheckpointTick;
+    
+    // Запись для воспроизведения: появления, тики и каждый ход NPC
+    bool recording;
+    
+    // Копии NPC соседних регионов у границы (region.h): только атакуют
+    // своих, сами в сетку и в npcs не попадают
+    std::vector<std::shared_ptr<NPC>> ghosts;
+    
+    // Параллельная фаза движения: пул участников и у каждого свой генератор
+    size_t movementThreads;
+    std::unique_ptr<ThreadPool> movementPool;
+    std::vector<std::mt19937> workerGens;
+    
+    // Пул потоков боев и ограничение на глубину его очередей
+    size_t fightThreads;
+    size_t fightQueueCapacity;
+    std::unique_ptr<FightPool> fightPool;
     
     // Вспомогательные методы
-    void movementWorker();
-    void fightWorker();
-    void mainWorker();
+    Task movementLoop();
+    void movementTick();
+    Task mapLoop();
+    unsigned nextSeed();
+    void startWorkers();
+    void stopWorkers();
+    // Фазы тика (вызывать под npcsMutex)
+    std::vector<size_t> collectAlive() const;
+    void beginTick(size_t aliveCount);
+    void moveAlive(const std::vector<size_t>& aliveIndices);
+    // Переносит переместившихся NPC в сетке (один поток, остальные стоят)
+    void reindexMoved(const std::vector<size_t>& aliveIndices, const std::vector<std::uint8_t>& moved);
+    // Пары в радиусе атаки для атакующих [begin, end): сначала свои, потом призраки
+    template <typename Fn>
+    void forEachEncounter(const std::vector<size_t>& aliveIndices, size_t begin, size_t end, Fn&& fn) const;
+    // Бои в пул (обычный режим) или по порядку в этом потоке (воспроизводимый)
+    void submitFights(const std::vector<size_t>& aliveIndices);
+    void resolveFightsInOrder(const std::vector<size_t>& aliveIndices);
+    void indexNPC(NPC* npc);
+    // Добавляет NPC в массив, слоты, сетку и счетчики (под npcsMutex)
+    void pushNPC(std::shared_ptr<NPC> npc);
+    void clearNPCs();
+    // Перестраивает columns или переносит в них смерти (под npcsMutex, из
+    // потока тика). Без режима Columns ничего не делает
+    void syncColumns();
+    bool columnsInSync() const;
+    bool shouldCompact() const;
+    CompactionReport compactLocked();
+    // Убирает NPC, для которых remove истинно, сохраняя порядок остальных;
+    // убранные складывает в taken (если задан). Вызывать под unique-блокировкой
+    size_t removeLocked(const std::function<bool(const NPC&)>& remove, std::vector<std::shared_ptr<NPC>>* taken);
+    void assignIds();
+    // Вызывать под npcsMutex (shared или unique)
+    void publishWorld() const;
+    // Отдает текущий снимок писателю точек (под npcsMutex). publish - сначала
+    // опубликовать снимок, если тик этого не сделал
+    void submitCheckpoint(bool publish);
+    // Сообщает о всех NPC наблюдателям (начало записи)
+    void recordSpawns();
     void processFight(FightTask& task);
+    template <typename Generator>
+    void resolveFightWith(FightTask& task, Generator& gen);
     void printMap();
 
 public:
     Dungeon();
     ~Dungeon();
+
+    // Один бой с заданным генератором: броски, смерть, счетчики и события.
+    // Открыт для бенчмарков, чтобы результат зависел только от зерна.
+    // Воспроизводимый режим берет CounterRng с ключом боя
+    void resolveFight(FightTask& task, std::mt19937& gen);
+    void resolveFight(FightTask& task, CounterRng& rng);
     
     void addNPC(std::shared_ptr<NPC> npc);
+    // Наблюдателей и политику переполнения шины задают до startGame
     void addObserver(std::shared_ptr<Observer> observer);
+    void setEventOverflowPolicy(OverflowPolicy policy);
+    // Публиковать появления NPC, начало каждого тика и все ходы, чтобы по
+    // двоичному журналу можно было восстановить мир (replay.h). Переключает
+    // шину на политику Block: потерянное или слитое событие испортит повтор
+    void setRecording(bool enabled);
+    bool isRecording() const { return recording; }
     void printNPCs() const;
     void saveToFile(const std::string& filename) const;
     void loadFromFile(const std::string& filename);
+    // Двоичный снимок (snapshot.h): все NPC, включая погибших. Загрузка
+    // заменяет мир; в режиме NPCStorage::Columns прочитанные массивы сразу
+    // становятся хранилищем подземелья
+    bool saveSnapshot(const std::string& filename) const;
+    bool loadSnapshot(const std::string& filename);
     void startGame();
+    // Останавливает игру и ждет все потоки; вызывать из владельца подземелья
     void stopGame();
+    // Только просит потоки остановиться (можно из обработчика сигнала)
+    void requestStop();
+    bool isRunning() const { return running; }
+    
+    // Создает NPC случайного типа в случайных точках карты (в арене)
+    void spawnRandomNPCs(size_t count);
+    // Останавливает игру, удаляет всех NPC и разом освобождает арену.
+    // Ссылки на NPC, полученные через getNPCs, после этого недействительны
+    void reset();
+    size_t getArenaBytes() const { return arena.getBytesReserved(); }
+    
+    // Убирает погибших NPC из массива и сетки. Порядок живых сохраняется,
+    // NPCHandle остаются действительными; задачи боев держат своих NPC
+    // через shared_ptr, поэтому не повисают
+    CompactionReport compact();
+    // Автоматическое уплотнение после тика, когда погибших не меньше
+    // deadFraction от всех NPC и не меньше minDead (deadFraction 0 - выключено)
+    void setCompaction(double deadFraction, size_t minDead);
+    const CompactionReport& getLastCompaction() const { return lastCompaction; }
+    
+    // Контрольные точки раз в everyTicks тиков в файл path, в фоновом
+    // потоке (checkpoint.h); последняя пишется при остановке игры
+    void enableCheckpoints(const std::string& path, std::uint64_t everyTicks, size_t fullEvery = 16);
+    const Checkpointer* getCheckpointer() const { return checkpointer.get(); }
+    // Заменяет мир последней целой точкой из файла: NPC, тик, зерно,
+    // счетчики боев. В воспроизводимом режиме продолжение совпадает
+    // с прогоном без перерыва. Если задан журнал logPath (setRecording)
+    // того же прогона, мир догоняется по нему от тика точки до конца
+    // записи - так без воспроизводимого режима теряется не больше, чем
+    // не успело попасть в журнал. false, если журнал не покрывает тик точки
+    bool resumeFromCheckpoint(const std::string& path, const std::string& logPath = "");
+    
+    // Постоянная ссылка на NPC с индексом index в getNPCs()
+    NPCHandle handleAt(size_t index) const;
+    // nullptr, если NPC по ссылке уже удален
+    std::shared_ptr<NPC> resolve(NPCHandle handle) const;
+    double getBytesPerNPC() const { return arena.getBytesPerObject(); }
+    // Прогоняет заданное число тиков без пауз, карты и отдельных потоков
+    // движения; бои каждого тика решаются до начала следующего
+    HeadlessReport runHeadless(std::uint64_t ticks);
+    
+    // Параметры партии (до startGame)
+    void setSeed(unsigned seed);
+    // Без зерна воспроизводимый режим использует зерно 0
+    void setDeterministic(bool enabled) { deterministic = enabled; }
+    bool isDeterministic() const { return deterministic; }
+    void setSpawnCount(size_t count) { config.spawnCount = count; }
+    // Представление NPC для шага движения и карты (до startGame)
+    void setStorage(NPCStorage newStorage);
+    NPCStorage getStorage() const { return storage; }
+    // Размеры мира, доли типов и дистанции. Дистанции применяются и к уже
+    // добавленным NPC; вызывать, пока игра не запущена
+    void setWorldConfig(const WorldConfig& newConfig);
+    const WorldConfig& getWorldConfig() const { return config; }
+    
+    // Пошаговый тик для внешнего цикла (режим регионов, region.h).
+    // startStepping запускает пулы; stepMovement начинает тик и делает
+    // ходы; затем владелец обменивается NPC с соседями; stepFights решает
+    // бои тика, дожидается их и при необходимости уплотняет;
+    // stepGhostFights решает бои призраков (setGhosts) со своими NPC и
+    // снимает призраков. Завершает stopGame. Без обмена и призраков шаги
+    // дают то же, что тик runHeadless
+    void startStepping();
+    void stepMovement();
+    void stepFights();
+    void stepGhostFights();
+    // Убирает из подземелья NPC, для которых pred истинно, и отдает их копии
+    std::vector<value::NPCValue> takeNPCsIf(const std::function<bool(const NPC&)>& pred);
+    // Копии NPC, для которых pred истинно; подземелье не меняется
+    std::vector<value::NPCValue> copyNPCsIf(const std::function<bool(const NPC&)>& pred) const;
+    // Добавляет NPC с их номерами (пришедших из другого региона)
+    void addNPCs(const std::vector<value::NPCValue>& values);
+    // Заменяет призраков: чужих NPC, которые могут атаковать своих
+    // (до следующего stepGhostFights)
+    void setGhosts(const std::vector<value::NPCValue>& values);
+    size_t getGhostCount() const { return ghosts.size(); }
+    void setGameDuration(int seconds) { gameDurationSeconds = seconds; }
+    int getGameDuration() const { return gameDurationSeconds; }
+    std::uint64_t getTick() const { return tick; }
+    
+    // Число потоков фазы движения (действует со следующего startGame)
+    void setMovementThreads(size_t threads);
+    size_t getMovementThreads() const { return movementThreads; }
+    // Число потоков боев и емкость их очередей (со следующего startGame)
+    void setFightThreads(size_t threads, size_t queueCapacity);
+    size_t getFightThreads() const { return fightThreads; }
     
+    // O(1): берутся из счетчиков, без обхода NPC и блокировок
     size_t getNPCCount() const;
     size_t getAliveCount() const;
+    StatsSnapshot getStats() const;
+    // Хеш id, координат и флагов жизни всех NPC: совпадает у прогонов
+    // с одинаковым результатом, удобно сравнивать эталонные запуски
+    std::uint64_t stateChecksum() const;
+    // Согласованный мир на конец последнего тика; не блокирует симуляцию.
+    // Снимок неизменяем, его можно держать сколько угодно
+    std::shared_ptr<const WorldSnapshot> getWorld() const;
+    // Живые NPC без копирования, но без блокировки: пользоваться только
+    // при остановленной игре, иначе - getWorld()
     const std::vector<std::shared_ptr<NPC>>& getNPCs() const;
 };
 
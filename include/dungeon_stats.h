@@ -0,0 +1,78 @@
+#ifndef DUNGEON_STATS_H
+#define DUNGEON_STATS_H
+
+#include "npc.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Сколько последних тиков помнит история смертей
+constexpr size_t DEATH_HISTORY = 64;
+
+// Снимок статистики на момент вызова getStats()
+struct StatsSnapshot {
+    size_t total = 0;
+    size_t alive = 0;
+    std::array<size_t, NPC_TYPE_COUNT> aliveByType{};
+    std::uint64_t fights = 0;
+    std::uint64_t kills = 0;
+    // Убийства по паре типов: [атакующий][защитник]
+    std::array<std::array<std::uint64_t, NPC_TYPE_COUNT>, NPC_TYPE_COUNT> killsByPair{};
+    std::uint64_t tick = 0;     // Заполняет Dungeon
+    size_t deathsLastTick = 0;     // Погибших за последний завершенный тик
+    size_t deathsCurrentTick = 0;  // Погибших в тике, который еще идет
+    // Погибшие по завершенным тикам, от старых к новым; заполнено deathsHistorySize
+    std::array<size_t, DEATH_HISTORY> deathsHistory{};
+    size_t deathsHistorySize = 0;
+    size_t compacted = 0;          // Погибших, убранных уплотнением
+};
+
+// Счетчики населения и боев, которые ведутся по ходу игры.
+// Каждое событие (добавление, бой, смерть) меняет пару атомарных
+// счетчиков, поэтому чтение статистики стоит O(1) при любом числе NPC
+// и не требует блокировки подземелья.
+class DungeonStats {
+private:
+    std::atomic<size_t> total;
+    std::array<std::atomic<size_t>, NPC_TYPE_COUNT> alive;
+    // Бои считают несколько потоков, держим счетчик в отдельной строке кэша
+    alignas(64) std::atomic<std::uint64_t> fights;
+    std::array<std::array<std::atomic<std::uint64_t>, NPC_TYPE_COUNT>, NPC_TYPE_COUNT> kills;
+    std::atomic<size_t> deathsCurrentTick;
+    // Кольцо смертей по тикам; пишет только поток тика в onTick
+    std::array<std::atomic<size_t>, DEATH_HISTORY> deathsHistory;
+    std::atomic<std::uint64_t> ticksClosed;
+    std::atomic<size_t> compacted;
+
+public:
+    DungeonStats();
+
+    void onAdded(NPCType type, bool isAlive);
+    // NPC ушел из подземелья (в другой регион), обратное onAdded
+    void onDeparted(NPCType type, bool isAlive);
+    void onFight() { fights.fetch_add(1, std::memory_order_relaxed); }
+    // Убийство по паре типов; саму смерть уже учел die() защитника
+    void onKill(NPCType attacker, NPCType defender);
+    // Живой NPC умер: вызывают NPC::die и NPCStore::die
+    void onDeath(NPCType type);
+    // Закрывает подсчет смертей прошлого тика
+    void onTick();
+    // Уплотнение убрало count погибших NPC из подземелья
+    void onRemoved(size_t count);
+    // Все счетчики, кроме населения, из сохраненного снимка
+    // (население заново считают добавленные NPC)
+    void restoreCounters(const StatsSnapshot& saved);
+    // Все NPC удалены: обнуляет население (бои и убийства сохраняются)
+    void clearPopulation();
+    // Полный сброс, например при Dungeon::reset
+    void reset();
+
+    size_t getTotal() const { return total.load(std::memory_order_relaxed); }
+    size_t getAlive() const;
+    size_t getAlive(NPCType type) const { return alive[static_cast<size_t>(type)].load(std::memory_order_relaxed); }
+    std::uint64_t getFights() const { return fights.load(std::memory_order_relaxed); }
+    StatsSnapshot snapshot() const;
+};
+
+#endif
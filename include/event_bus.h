@@ -0,0 +1,116 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "observer.h"
+#include "mpmc_queue.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include <type_traits>
+
+// Запись о событии в кольцевом буфере шины (фиксированного размера)
+struct Event {
+    enum class Type : std::uint8_t { Fight, Move, Die, Spawn, Tick, Remove };
+
+    Type type = Type::Fight;
+    bool defenderDied = false;
+    bool alive = true;          // Появившийся NPC жив (только для Spawn)
+    NPCType npcType = NPCType::Dragon;
+    NPCRef npc;           // Атакующий / переместившийся / погибший / убранный
+    NPCRef target;        // Защитник (только для боя)
+    double x = 0, y = 0;  // Новая позиция (движение и появление)
+    std::uint64_t tick = 0;
+};
+
+static_assert(std::is_trivially_copyable<Event>::value, "событие копируется как набор байт");
+
+// Что делать, если кольцо заполнено
+enum class OverflowPolicy {
+    Block,     // Ждать освобождения места
+    Drop,      // Отбросить событие и посчитать его
+    Coalesce   // Сливать перемещения одного NPC в последнее; бои и смерти ждут.
+               // Порядок событий сохраняется: слитое перемещение встает на
+               // место последнего, а кольцо ждет, пока слитые не доставлены
+};
+
+// Асинхронная шина событий.
+// Потоки симуляции кладут события в кольцо и сразу возвращаются, а
+// отдельный поток-диспетчер забирает их пачками и раздает наблюдателям,
+// вызывая flush() у каждого наблюдателя один раз на пачку.
+// Сама шина тоже Observer, поэтому подключается туда же, куда и обычные.
+class EventBus : public Observer {
+private:
+    MPMCQueue<Event> ring;
+    OverflowPolicy policy;
+    size_t batchSize;
+    std::vector<std::shared_ptr<Observer>> observers;
+
+    std::thread dispatcher;
+    std::atomic<bool> running;
+    std::mutex waitMutex;
+    std::condition_variable eventCV;  // Для диспетчера: появились события
+    std::condition_variable spaceCV;  // Для производителей: освободилось место
+    std::condition_variable idleCV;   // Для flush(): все доставлено
+    std::atomic<bool> dispatcherSleeping;
+    std::atomic<size_t> waitingProducers;
+    std::atomic<size_t> inFlight;     // Принято, но еще не доставлено
+
+    // Перемещения, не поместившиеся в кольцо, в порядке поступления.
+    // Пока они есть (overflowing), новые события в кольцо не идут, иначе
+    // обогнали бы их. Новое перемещение NPC вычеркивает его прежнее
+    std::mutex coalesceMutex;
+    std::atomic<bool> overflowing;
+    std::vector<Event> overflow;
+    std::vector<std::uint8_t> superseded;                    // Вычеркнуто ли overflow[i]
+    std::unordered_map<std::uint64_t, size_t> overflowIndex;  // NPC -> его перемещение в overflow
+
+    std::atomic<size_t> published;
+    std::atomic<size_t> dropped;
+    std::atomic<size_t> coalesced;
+
+    void publish(Event&& event);
+    void wakeDispatcher();
+    void dispatchLoop();
+    size_t drainBatch(std::vector<Event>& batch);
+    void deliver(const Event& event);
+
+public:
+    explicit EventBus(size_t capacity = 65536, OverflowPolicy policy = OverflowPolicy::Block,
+                      size_t batchSize = 256);
+    ~EventBus() override;
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    // Настройка до start()
+    void addObserver(std::shared_ptr<Observer> observer);
+    void setOverflowPolicy(OverflowPolicy newPolicy) { policy = newPolicy; }
+    OverflowPolicy getOverflowPolicy() const { return policy; }
+
+    void start();
+    // Доставляет все накопленное и останавливает диспетчер
+    void stop();
+
+    void onFight(NPCRef attacker, NPCRef defender, bool defenderDied) override;
+    void onMove(NPCRef npc, double x, double y) override;
+    void onDie(NPCRef npc) override;
+    void onSpawn(NPCRef npc, NPCType type, double x, double y, bool alive) override;
+    void onTick(std::uint64_t tick) override;
+    void onRemove(NPCRef npc) override;
+    // Ждет, пока все принятые события будут доставлены
+    void flush() override;
+
+    size_t getPublished() const { return published; }
+    size_t getDropped() const { return dropped; }
+    size_t getCoalesced() const { return coalesced; }
+    // Принято, но еще не доставлено наблюдателям
+    size_t getPending() const { return inFlight; }
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "name_table.h"
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <ostream>
+#include <cstdint>
+
+// Формат журнала событий.
+//
+// Текстовый журнал - строки вида "[БОЙ] ...", "[ДВИЖЕНИЕ] ...", "[СМЕРТЬ] ...".
+//
+// Двоичный журнал: заголовок "DLOG" + uint16 версия + uint16 резерв,
+// затем записи, каждая начинается с байта типа (порядок байт - как на
+// хосте). На NPC записи ссылаются по его постоянному 32-битному номеру
+// (NPC::getId); имя NPC передается один раз записью Name. Каждый файл
+// (в том числе после ротации) самодостаточен: имена в нем пишутся заново.
+//   Name:  uint32 id, uint16 длина, байты UTF-8
+//   Fight: uint32 атакующий, uint32 защитник, uint8 защитник погиб
+//   Move:  uint32 id, double x, double y
+//   Die:   uint32 id
+//   Spawn: uint32 id, uint8 тип, uint8 жив, double x, double y (с версии 2)
+//   Tick:  uint64 номер начавшегося тика (с версии 2)
+//   Remove: uint32 id - уплотнение убрало погибшего из мира (с версии 3)
+// NPC без постоянного номера пишутся под временным номером от
+// LOG_LOCAL_ID_BASE (NPC::ref): свой у каждого объекта, но мир по таким
+// номерам не восстанавливается.
+// Spawn, Tick и Remove пишутся, когда подземелье ведет запись для
+// воспроизведения (Dungeon::setRecording): тогда в журнале есть все NPC,
+// каждый их ход и каждое удаление.
+const char EVENT_LOG_MAGIC[4] = {'D', 'L', 'O', 'G'};
+const std::uint16_t EVENT_LOG_VERSION = 3;
+const std::uint32_t LOG_LOCAL_ID_BASE = NPCRef::DETACHED_ID_BASE;
+
+struct LogRecord {
+    enum class Type : std::uint8_t { Name = 0, Fight = 1, Move = 2, Die = 3, Spawn = 4, Tick = 5, Remove = 6 };
+
+    Type type = Type::Name;
+    std::uint32_t npc = 0;     // Атакующий / переместившийся / погибший / убранный / id имени
+    std::uint32_t target = 0;  // Защитник (только для боя)
+    double x = 0, y = 0;
+    bool defenderDied = false;
+    std::uint8_t npcType = 0;  // NPCType (только для Spawn)
+    bool alive = true;         // Только для Spawn
+    std::uint64_t tick = 0;    // Только для Tick
+    std::string name;          // Только для записи Name
+};
+
+// Текстовое представление событий (общее для FileObserver и декодера)
+void writeFightText(std::ostream& os, const std::string& attacker, const std::string& defender, bool defenderDied);
+void writeMoveText(std::ostream& os, const std::string& npcName, double x, double y);
+void writeDieText(std::ostream& os, const std::string& npcName);
+void writeSpawnText(std::ostream& os, const std::string& npcName, const char* typeName, double x, double y);
+void writeTickText(std::ostream& os, std::uint64_t tick);
+void writeRemoveText(std::ostream& os, const std::string& npcName);
+
+// Двоичное кодирование записей
+void writeLogHeader(std::ostream& os);
+void writeLogRecord(std::ostream& os, const LogRecord& record);
+
+// Последовательное чтение двоичного журнала
+class EventLogReader {
+private:
+    std::ifstream file;
+    std::unordered_map<std::uint32_t, std::string> names;  // Номер NPC -> имя
+
+public:
+    // false, если файл не открылся или это не двоичный журнал
+    bool open(const std::string& path);
+    // Читает следующую запись; записи Name сразу попадают в таблицу имен
+    bool next(LogRecord& record);
+    // Позиция в файле и переход к ней (для индексов по журналу)
+    std::uint64_t tell();
+    void seek(std::uint64_t offset);
+
+    const std::string& nameOf(std::uint32_t id) const;
+    // Декодирует запись в текстовую строку; для Name ничего не пишет
+    void writeText(std::ostream& os, const LogRecord& record) const;
+};
+
+#endif
@@ -4,19 +4,40 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 // Forward declaration
 class NPC;
+class NPCArena;
+enum class NPCType : std::uint8_t;
+
+// Прямоугольник, в котором createMany расставляет NPC
+struct SpawnRegion {
+    double minX = 0, minY = 0;
+    double maxX = 100, maxY = 100;
+};
 
 // Factory для создания NPC
 class NPCFactory {
 private:
     static std::string generateRandomName();
+    // Номер готового имени в NameTable, без склейки строк
+    static std::uint32_t pickRandomNameId();
     
 public:
     static std::shared_ptr<NPC> createNPC(const std::string& type, double x, double y, const std::string& name);
+    static std::shared_ptr<NPC> createNPC(NPCType type, double x, double y, const std::string& name);
     static std::shared_ptr<NPC> createRandomNPC(double x, double y);
+    // Массовое создание случайных NPC в области. С ареной объекты лежат
+    // в ее блоках; имена не копируются, NPC хранят только их номера.
+    // typeWeights - относительные доли типов по NPCType (пусто - поровну)
+    static std::vector<std::shared_ptr<NPC>> createMany(size_t count, const SpawnRegion& region,
+                                                        NPCArena* arena = nullptr,
+                                                        const std::vector<double>& typeWeights = {});
     static std::shared_ptr<NPC> loadFromStream(std::istream& is);
+    // Делает случайные имена и типы воспроизводимыми
+    static void setSeed(unsigned seed);
 };
 
 #endif
\ No newline at end of file
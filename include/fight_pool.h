@@ -0,0 +1,91 @@
+#ifndef FIGHT_POOL_H
+#define FIGHT_POOL_H
+
+#include "npc.h"
+#include "mpmc_queue.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <array>
+#include <algorithm>
+#include <cstddef>
+
+// Структура для задания боя
+struct FightTask {
+    std::shared_ptr<NPC> attacker;
+    std::shared_ptr<NPC> defender;
+};
+
+// Пул потоков боев с шардированием и кражей работы.
+// Задача попадает в lock-free кольцо потока, выбранного по защитнику
+// (если оно заполнено, то в следующее); свободный поток забирает задачи
+// из чужих колец. Пачка задач кладется без блокировок, а спящие потоки
+// будятся один раз на пачку. Один и тот же NPC никогда не участвует
+// в двух боях одновременно: на время боя берутся полосатые блокировки
+// атакующего и защитника. Общая глубина очередей ограничена, при
+// заполнении submit ждет (обратное давление на движение).
+class FightPool {
+public:
+    using Handler = std::function<void(FightTask&)>;
+
+private:
+    using Shard = MPMCQueue<FightTask>;
+
+    static const size_t LOCK_STRIPES = 256;
+
+    Handler handler;
+    size_t capacity;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::thread> threads;
+    std::array<std::mutex, LOCK_STRIPES> npcLocks;
+
+    std::mutex waitMutex;
+    std::condition_variable workCV;   // Появились задачи
+    std::condition_variable spaceCV;  // Освободилось место
+    std::condition_variable idleCV;   // Очереди пусты и ни один бой не идет
+    // Увеличивается после вставки, поэтому поток, успевший забрать задачу
+    // раньше, ненадолго уводит его в минус
+    std::atomic<std::ptrdiff_t> queued;
+    std::atomic<size_t> busyWorkers;  // Потоки, которые ищут или решают задачу
+    std::atomic<size_t> sleepingWorkers;
+    std::atomic<size_t> waitingProducers;
+    std::atomic<size_t> waitingIdle;
+    std::atomic<bool> running;
+
+    size_t shardFor(const NPC* npc) const;
+    std::mutex& lockFor(const NPC* npc);
+    // Кладет задачи одного кольца пачкой, начиная с него; возвращает число положенных
+    size_t pushFrom(size_t home, FightTask* tasks, size_t count);
+    bool tryTake(size_t worker, FightTask& task);
+    void resolve(FightTask& task);
+    void workerLoop(size_t worker);
+    // Снимает отметку занятости и будит waitIdle, если работы больше нет
+    void releaseWorker();
+
+public:
+    FightPool(size_t workers, size_t capacity, Handler handler);
+    ~FightPool();
+
+    FightPool(const FightPool&) = delete;
+    FightPool& operator=(const FightPool&) = delete;
+
+    void start();
+    void stop();
+
+    // Ставит пачку задач в кольца и будит потоки один раз. Если места
+    // нет, ждет его; после stop() оставшиеся задачи отбрасываются.
+    void submit(std::vector<FightTask>& batch);
+
+    // Ждет, пока все поставленные задачи не будут решены
+    void waitIdle();
+
+    size_t depth() const { return static_cast<size_t>(std::max<std::ptrdiff_t>(0, queued.load())); }
+    size_t getCapacity() const { return capacity; }
+    size_t getWorkers() const { return shards.size(); }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <utility>
+
+// Ограниченная lock-free очередь для многих производителей и потребителей
+// (кольцевой буфер Д. Вьюкова). У каждой ячейки есть номер
+// последовательности: по нему поток понимает, свободна ли ячейка для
+// записи или уже содержит данные для чтения, и захватывает ее одной
+// операцией compare_exchange над позицией головы или хвоста.
+// Емкость округляется вверх до степени двойки.
+template <typename T>
+class MPMCQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static const size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    // Позиции разнесены по разным кэш-линиям, чтобы не было ложного разделения
+    alignas(CACHE_LINE) std::atomic<size_t> enqueuePos;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeuePos;
+
+    static size_t roundUp(size_t value) {
+        size_t result = 2;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+    // Захватывает ячейку для записи; nullptr, если очередь полна
+    Cell* claimForPush() {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Захватывает подряд до count свободных ячеек одной операцией над
+    // хвостом; возвращает их число (0, если очередь полна), first - позиция первой
+    size_t claimRangeForPush(size_t count, size_t& first) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            size_t free = 0;
+            while (free < count && free <= mask) {
+                size_t seq = cells[(pos + free) & mask].sequence.load(std::memory_order_acquire);
+                if (seq != pos + free) break;
+                free++;
+            }
+            if (free == 0) {
+                auto diff = static_cast<std::ptrdiff_t>(cells[pos & mask].sequence.load(std::memory_order_acquire)) -
+                            static_cast<std::ptrdiff_t>(pos);
+                if (diff < 0) return 0;
+                pos = enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            // Свободную ячейку занимает только тот, кто сдвинул хвост,
+            // поэтому после удачного обмена все free ячеек наши
+            if (enqueuePos.compare_exchange_weak(pos, pos + free, std::memory_order_relaxed)) {
+                first = pos;
+                return free;
+            }
+        }
+    }
+
+public:
+    explicit MPMCQueue(size_t capacity)
+        : cells(new Cell[roundUp(capacity)]), mask(roundUp(capacity) - 1), enqueuePos(0), dequeuePos(0) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // Приблизительный размер: точен, только если очередь никто не трогает
+    size_t sizeApprox() const {
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : 0;
+    }
+
+    bool tryPush(T&& value) {
+        Cell* cell = claimForPush();
+        if (!cell) return false;
+        size_t pos = cell->sequence.load(std::memory_order_relaxed);
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& value) {
+        T copy(value);
+        return tryPush(std::move(copy));
+    }
+
+    // Кладет начало пачки, пока есть место; возвращает число положенных.
+    // Ячейки захватываются диапазонами, а не по одной
+    size_t pushBatch(T* items, size_t count) {
+        size_t pushed = 0;
+        while (pushed < count) {
+            size_t first = 0;
+            size_t claimed = claimRangeForPush(count - pushed, first);
+            if (claimed == 0) break;
+            for (size_t i = 0; i < claimed; ++i) {
+                Cell& cell = cells[(first + i) & mask];
+                cell.data = std::move(items[pushed + i]);
+                cell.sequence.store(first + i + 1, std::memory_order_release);
+            }
+            pushed += claimed;
+        }
+        return pushed;
+    }
+
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell->data);
+                    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Общая таблица имен NPC.
+// Каждое различное имя хранится один раз и получает постоянный номер;
+// NPC и события держат только номера, а строка нужна лишь при выводе.
+// Строки лежат в блоках фиксированного размера и никогда не переезжают,
+// поэтому чтение по номеру идет без блокировок, а добавление - под мьютексом.
+// Имена не удаляются до конца программы, а различных имен может быть не
+// больше MAX_NAMES (около 4 млн) на все подземелья: дальше intern бросает
+// std::length_error. Случайные имена фабрики - это постоянный набор
+// сочетаний; таблицу растят только имена, заданные извне (конструктор
+// NPC со строкой, файлы, контрольные точки, журналы).
+class NameTable {
+private:
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+    static const size_t MAX_CHUNKS = 1024;
+
+public:
+    static const size_t MAX_NAMES = CHUNK_SIZE * MAX_CHUNKS;
+
+private:
+
+    std::array<std::atomic<std::string*>, MAX_CHUNKS> chunks;
+    std::atomic<std::uint32_t> count;
+    std::mutex mutex;
+    std::unordered_map<std::string_view, std::uint32_t> lookup;  // Ссылается на строки в блоках
+
+public:
+    NameTable();
+    ~NameTable();
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    // Таблица, общая для всей программы
+    static NameTable& global();
+
+    // Номер имени; одинаковые имена получают один номер.
+    // std::length_error, если новое имя было бы MAX_NAMES + 1-м
+    std::uint32_t intern(std::string_view name);
+    // Для неизвестного номера возвращает "?"
+    const std::string& name(std::uint32_t id) const;
+    size_t size() const { return count; }
+};
+
+// Ссылка на NPC в событиях: постоянный номер NPC и номер его имени.
+// Запись фиксированного размера, имя разрешается только при выводе
+struct NPCRef {
+    static constexpr std::uint32_t NO_ID = 0xFFFFFFFFu;  // Совпадает с NPC::NO_ID
+    // Номера от этого и выше NPC без постоянного номера получают при
+    // создании (NPC::ref); подземелье столько NPC не нумерует
+    static constexpr std::uint32_t DETACHED_ID_BASE = 0x80000000u;
+
+    std::uint32_t id = NO_ID;
+    std::uint32_t nameId = 0;
+
+    const std::string& name() const { return NameTable::global().name(nameId); }
+};
+
+#endif
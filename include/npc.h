@@ -6,79 +6,227 @@
 #include <memory>
 #include <random>
 #include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include "name_table.h"
 
 class Visitor;
+class SpatialGrid;
+class CounterRng;
+class DungeonStats;
+
+// Тег типа NPC: позволяет хранить и сравнивать типы без строк и RTTI
+enum class NPCType : std::uint8_t {
+    Dragon = 0,
+    Bull = 1,
+    Toad = 2
+};
+
+const size_t NPC_TYPE_COUNT = 3;
+
+// Характеристики типа NPC
+struct NPCTypeInfo {
+    const char* name;    // Имя типа в файлах сохранения
+    const char* symbol;  // Символ на карте
+    int moveDistance;
+    int killDistance;
+};
+
+// Характеристики типов: ход и дистанция убийства
+constexpr NPCTypeInfo NPC_TYPE_INFO[NPC_TYPE_COUNT] = {
+    {"Dragon", "D", 50, 30},
+    {"Bull",   "B", 30, 10},
+    {"Toad",   "T", 1,  10},
+};
+
+constexpr const NPCTypeInfo& npcTypeInfo(NPCType type) {
+    return NPC_TYPE_INFO[static_cast<size_t>(type)];
+}
+// Возвращает false, если имя типа неизвестно
+bool npcTypeFromName(const std::string& name, NPCType& type);
+// Правила варианта 20: кто кого может атаковать
+struct AttackRule {
+    NPCType attacker;
+    NPCType defender;
+};
+
+constexpr AttackRule ATTACK_RULES[] = {
+    {NPCType::Dragon, NPCType::Bull},  // Дракон ест быков
+    {NPCType::Bull, NPCType::Toad},    // Бык топчет жаб
+};                                     // Жабы никого не атакуют
+
+using AttackMatrix = std::array<std::array<bool, NPC_TYPE_COUNT>, NPC_TYPE_COUNT>;
+
+// Таблица атакующий x защитник, собирается из правил при компиляции
+constexpr AttackMatrix makeAttackMatrix() {
+    AttackMatrix matrix{};
+    for (const AttackRule& rule : ATTACK_RULES) {
+        matrix[static_cast<size_t>(rule.attacker)][static_cast<size_t>(rule.defender)] = true;
+    }
+    return matrix;
+}
+
+constexpr AttackMatrix ATTACK_MATRIX = makeAttackMatrix();
+
+// Проверка боя - одно обращение к таблице
+constexpr bool canTypeAttack(NPCType attacker, NPCType defender) {
+    return ATTACK_MATRIX[static_cast<size_t>(attacker)][static_cast<size_t>(defender)];
+}
+
+// Может ли тип атаковать хоть кого-то: остальных поиск боев пропускает
+constexpr bool canTypeAttackAny(NPCType attacker) {
+    for (bool allowed : ATTACK_MATRIX[static_cast<size_t>(attacker)]) {
+        if (allowed) return true;
+    }
+    return false;
+}
+
+static_assert(canTypeAttack(NPCType::Dragon, NPCType::Bull) && !canTypeAttack(NPCType::Bull, NPCType::Dragon),
+              "таблица атак не совпадает с правилами варианта 20");
+static_assert(!canTypeAttackAny(NPCType::Toad), "жабы никого не атакуют");
+
+// Прямоугольник [0, width] x [0, height], за который NPC не выходят.
+// Передается в шаг по ссылке: размеры мира задает WorldConfig подземелья
+struct WorldBounds {
+    double width = 100;
+    double height = 100;
+
+    bool contains(double x, double y) const { return x >= 0 && x <= width && y >= 0 && y <= height; }
+};
+
+// Имя, уже внесенное в NameTable (конструктор не ищет его заново)
+struct InternedName {
+    std::uint32_t id;
+};
 
 // Абстрактный класс NPC
-class NPC {
+class NPC : public std::enable_shared_from_this<NPC> {
 protected:
+    NPCType type;
+    std::uint32_t id;  // Постоянный номер, назначает Dungeon
     double x, y;
-    std::string name;
-    bool alive;
+    std::uint32_t nameId;  // Номер в NameTable::global()
+    // Атомарный: бои разных потоков и читатели снимков обращаются без блокировки
+    std::atomic<bool> alive;
     int moveDistance;  // Расстояние хода за один шаг
     int killDistance;  // Расстояние для атаки
 
+private:
+    // Положение в пространственном индексе (заполняет SpatialGrid)
+    SpatialGrid* grid = nullptr;
+    int gridCell = -1;
+    // Номер для событий, пока Dungeon не назначил постоянный: у каждого
+    // объекта свой, от NPCRef::DETACHED_ID_BASE (лежит в выравнивании после gridCell)
+    std::uint32_t detachedId;
+    size_t gridSlot = 0;
+    friend class SpatialGrid;
+    // Счетчики подземелья, в котором живет NPC (их ведет die())
+    DungeonStats* stats = nullptr;
+
+    bool tryMoveBy(int dx, int dy, const WorldBounds& bounds);
+
 public:
-    NPC(double x, double y, const std::string& name, int moveDist, int killDist);
+    NPC(NPCType type, double x, double y, const std::string& name, int moveDist, int killDist);
+    NPC(NPCType type, double x, double y, InternedName name, int moveDist, int killDist);
     virtual ~NPC() = default;
 
+    static constexpr std::uint32_t NO_ID = NPCRef::NO_ID;
+
+    NPCType getTypeTag() const { return type; }
+    std::uint32_t getId() const { return id; }
+    void setId(std::uint32_t newId) { id = newId; }
     double getX() const { return x; }
     double getY() const { return y; }
-    const std::string& getName() const { return name; }
+    const std::string& getName() const { return NameTable::global().name(nameId); }
+    std::uint32_t getNameId() const { return nameId; }
+    // Ссылка для событий: номера вместо строк. NPC вне подземелья
+    // отличаются по своему временному номеру, а не по имени
+    NPCRef ref() const { return NPCRef{id != NO_ID ? id : detachedId, nameId}; }
     bool isAlive() const { return alive; }
-    void die() { alive = false; }
+    // true, если NPC был жив; такая смерть сразу попадает в счетчики подземелья
+    bool die();
+    // Подключает счетчики подземелья (nullptr - отключает); назначает Dungeon
+    void attachStats(DungeonStats* dungeonStats) { stats = dungeonStats; }
     int getMoveDistance() const { return moveDistance; }
     int getKillDistance() const { return killDistance; }
+    // Дистанции из настроек мира вместо значений типа по умолчанию
+    void setDistances(int move, int kill) {
+        moveDistance = move;
+        killDistance = kill;
+    }
     
     virtual std::string getType() const = 0;
     virtual std::string getTypeSymbol() const = 0; // Символ для отображения на карте
 
     double distanceTo(const NPC& other) const;
-    void move(std::mt19937& gen);
+    void move(std::mt19937& gen, const WorldBounds& bounds = WorldBounds{});
+    // Только меняет координаты, не трогая пространственный индекс.
+    // Используется параллельной фазой движения; индекс потом обновляет reindex().
+    bool step(std::mt19937& gen, const WorldBounds& bounds = WorldBounds{});
+    // Воспроизводимый шаг: поток чисел задан ключом (зерно, тик, id)
+    bool step(CounterRng& rng, const WorldBounds& bounds = WorldBounds{});
+    // Координаты шага, сделанного в другом представлении (NPCStore);
+    // индекс, как и после step, обновляет reindex()
+    void place(double newX, double newY) {
+        x = newX;
+        y = newY;
+    }
+    void reindex();
     virtual void save(std::ostream& os) const;
     virtual void accept(Visitor& visitor) = 0;
     
     // Методы для боя
-    virtual bool canAttack(NPC* other) = 0;
+    bool canAttack(const NPC* other) const { return canTypeAttack(type, other->type); }
     virtual int rollAttack(std::mt19937& gen) = 0;
     virtual int rollDefense(std::mt19937& gen) = 0;
+    // Воспроизводимые броски: не зависят от реализации std::uniform_int_distribution
+    virtual int rollAttack(CounterRng& rng) = 0;
+    virtual int rollDefense(CounterRng& rng) = 0;
 };
 
 // Конкретные классы NPC
 class Dragon : public NPC {
 public:
     Dragon(double x, double y, const std::string& name);
+    Dragon(double x, double y, InternedName name);
     std::string getType() const override;
     std::string getTypeSymbol() const override { return "D"; }
     void accept(Visitor& visitor) override;
     
-    bool canAttack(NPC* other) override;
     int rollAttack(std::mt19937& gen) override;
     int rollDefense(std::mt19937& gen) override;
+    int rollAttack(CounterRng& rng) override;
+    int rollDefense(CounterRng& rng) override;
 };
 
 class Bull : public NPC {
 public:
     Bull(double x, double y, const std::string& name);
+    Bull(double x, double y, InternedName name);
     std::string getType() const override;
     std::string getTypeSymbol() const override { return "B"; }
     void accept(Visitor& visitor) override;
     
-    bool canAttack(NPC* other) override;
     int rollAttack(std::mt19937& gen) override;
     int rollDefense(std::mt19937& gen) override;
+    int rollAttack(CounterRng& rng) override;
+    int rollDefense(CounterRng& rng) override;
 };
 
 class Toad : public NPC {
 public:
     Toad(double x, double y, const std::string& name);
+    Toad(double x, double y, InternedName name);
     std::string getType() const override;
     std::string getTypeSymbol() const override { return "T"; }
     void accept(Visitor& visitor) override;
     
-    bool canAttack(NPC* other) override;
     int rollAttack(std::mt19937& gen) override;
     int rollDefense(std::mt19937& gen) override;
+    int rollAttack(CounterRng& rng) override;
+    int rollDefense(CounterRng& rng) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef NPC_ARENA_H
+#define NPC_ARENA_H
+
+#include <memory_resource>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <cstddef>
+
+// Считает байты, прошедшие через ресурс, и передает запросы дальше
+class CountingResource : public std::pmr::memory_resource {
+private:
+    std::pmr::memory_resource* upstream;
+    // Освобождать объекты могут любые потоки, поэтому счетчики атомарные
+    std::atomic<size_t> total{0};  // Выделено всего
+    std::atomic<size_t> live{0};   // Выделено и еще не возвращено
+
+protected:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* p, size_t size, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+
+    size_t getTotal() const { return total; }
+    size_t getLive() const { return live; }
+    void reset() {
+        total = 0;
+        live = 0;
+    }
+};
+
+// Арена для массового создания NPC.
+// Объекты NPC вместе с блоками управления shared_ptr выделяются из
+// крупных блоков пулом (synchronized_pool_resource). Память удаленного
+// NPC возвращается в пул и достается следующим NPC того же размера,
+// а куче все блоки возвращаются разом в release(). Пока жив хоть один
+// объект из арены (чей-то shared_ptr), release() ничего не освобождает.
+class NPCArena {
+private:
+    CountingResource slabs;                   // Блоки, взятые у кучи
+    std::pmr::synchronized_pool_resource pool;
+    CountingResource used;                    // Байты, отданные объектам
+    std::atomic<size_t> objects{0};
+
+public:
+    static const size_t SLAB_BYTES = 64 * 1024;
+
+    NPCArena();
+    NPCArena(const NPCArena&) = delete;
+    NPCArena& operator=(const NPCArena&) = delete;
+
+    // Создает объект и его блок управления shared_ptr в арене
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make(Args&&... args) {
+        objects++;
+        return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(&used), std::forward<Args>(args)...);
+    }
+
+    // Возвращает все блоки куче; false, если в арене еще есть живые
+    // объекты - тогда блоки остаются в пуле для следующих NPC
+    bool release();
+
+    size_t getObjectCount() const { return objects; }
+    size_t getBytesUsed() const { return used.getTotal(); }
+    // Занято живыми объектами сейчас (освобожденное вернулось в пул)
+    size_t getBytesLive() const { return used.getLive(); }
+    size_t getBytesReserved() const { return slabs.getLive(); }
+    // Средний расход на один NPC с учетом блока управления
+    double getBytesPerObject() const { return objects ? static_cast<double>(getBytesUsed()) / objects : 0; }
+};
+
+#endif
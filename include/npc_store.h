@@ -0,0 +1,79 @@
+#ifndef NPC_STORE_H
+#define NPC_STORE_H
+
+#include "npc.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <cstdint>
+
+class CounterRng;
+class NPCArena;
+
+// Хранилище NPC в виде структуры массивов (SoA).
+// Координаты, флаги жизни, типы и дистанции лежат в отдельных
+// непрерывных массивах, поэтому проходы по всем NPC (подсчет живых,
+// отрисовка карты, движение) читают память последовательно и без
+// разыменования указателей. Имена - номера в NameTable::global(), как у NPC.
+// Подземелье ведет такое хранилище рядом с объектами NPC и двигает по нему
+// NPC в режиме NPCStorage::Columns (dungeon.h).
+class NPCStore {
+private:
+    std::vector<double> xs, ys;
+    std::vector<std::uint8_t> alive;
+    std::vector<NPCType> types;
+    std::vector<int> moveDistances, killDistances;
+    std::vector<std::uint32_t> nameIds;
+    std::vector<std::uint32_t> ids;  // Постоянные номера NPC (NPC::NO_ID, если нет)
+
+    bool tryMoveBy(size_t index, int dx, int dy, const WorldBounds& bounds);
+
+public:
+    size_t add(NPCType type, double x, double y, const std::string& name, std::uint32_t id = NPC::NO_ID);
+    size_t add(NPCType type, double x, double y, InternedName name, std::uint32_t id = NPC::NO_ID);
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return xs.size(); }
+
+    // Массовая загрузка готовых массивов (например, из отображенного в память
+    // файла): данные копируются целиком, дистанции берутся из таблицы типов.
+    // nameIndexArray - номера в nameIds, который переводит их в номера
+    // NameTable (так имена файла вносятся в таблицу по одному разу).
+    // Без массива номеров NPC (nullptr) все NPC получают NPC::NO_ID
+    void assignArrays(size_t count, const NPCType* typeArray, const std::uint8_t* aliveArray,
+                      const double* xArray, const double* yArray, const std::uint32_t* nameIndexArray,
+                      const std::vector<std::uint32_t>& nameIdTable, const std::uint32_t* idArray);
+
+    // Преобразования из обычного представления и обратно. Объекты
+    // получают номера имен, номера NPC и дистанции из хранилища; с ареной
+    // они лежат в ее блоках (как у NPCFactory::createMany)
+    void assign(const std::vector<std::shared_ptr<NPC>>& npcs);
+    std::shared_ptr<NPC> toNPC(size_t index, NPCArena* arena = nullptr) const;
+    std::vector<std::shared_ptr<NPC>> toNPCs(NPCArena* arena = nullptr) const;
+
+    // Точечные изменения (для хранилища, которое ведется рядом с NPC)
+    void setAlive(size_t index, bool value) { alive[index] = value ? 1 : 0; }
+    void setId(size_t index, std::uint32_t id) { ids[index] = id; }
+    void setDistances(size_t index, int move, int kill) {
+        moveDistances[index] = move;
+        killDistances[index] = kill;
+    }
+
+    // Горячие циклы по всем NPC
+    size_t aliveCount() const;
+    // Те же правила хода, что у NPC::step: только координаты, true - если сдвинулся
+    bool step(size_t index, std::mt19937& gen, const WorldBounds& bounds = WorldBounds{});
+    bool step(size_t index, CounterRng& rng, const WorldBounds& bounds = WorldBounds{});
+
+    // Прямой доступ к массивам (для пакетных вычислений)
+    const double* xData() const { return xs.data(); }
+    const double* yData() const { return ys.data(); }
+    const std::uint8_t* aliveData() const { return alive.data(); }
+    const NPCType* typeData() const { return types.data(); }
+    const std::uint32_t* nameIdData() const { return nameIds.data(); }
+    const std::uint32_t* idData() const { return ids.data(); }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef NPC_VALUE_H
+#define NPC_VALUE_H
+
+#include "npc.h"
+#include <variant>
+#include <vector>
+#include <string>
+#include <memory>
+#include <type_traits>
+
+// Альтернативное представление NPC в виде значений.
+// Каждый NPC - это std::variant<Dragon, Bull, Toad>, хранимый прямо в
+// векторе без отдельного выделения памяти; тип определяется индексом
+// варианта. Используется как формат переноса: снимки мира, контрольные
+// точки, обмен между регионами и повтор журнала. Движение и бои идут по
+// объектам NPC с виртуальной диспетчеризацией.
+namespace value {
+
+// Общие поля всех типов
+struct Body {
+    std::uint32_t id = NPC::NO_ID;
+    std::uint32_t nameId = 0;  // Номер в NameTable::global()
+    double x = 0, y = 0;
+    bool alive = true;
+};
+
+template <NPCType Tag>
+struct Creature : Body {
+    static constexpr NPCType tag = Tag;
+};
+
+using Dragon = Creature<NPCType::Dragon>;
+using Bull = Creature<NPCType::Bull>;
+using Toad = Creature<NPCType::Toad>;
+
+// Порядок альтернатив совпадает с NPCType: индекс варианта и есть тег типа
+using NPCValue = std::variant<Dragon, Bull, Toad>;
+
+static_assert(std::variant_size_v<NPCValue> == NPC_TYPE_COUNT, "вариант должен покрывать все типы");
+static_assert(std::is_same_v<std::variant_alternative_t<static_cast<size_t>(NPCType::Dragon), NPCValue>, Dragon> &&
+              std::is_same_v<std::variant_alternative_t<static_cast<size_t>(NPCType::Bull), NPCValue>, Bull> &&
+              std::is_same_v<std::variant_alternative_t<static_cast<size_t>(NPCType::Toad), NPCValue>, Toad>,
+              "порядок альтернатив не совпадает с NPCType");
+
+inline NPCType typeOf(const NPCValue& npc) {
+    return static_cast<NPCType>(npc.index());
+}
+
+inline Body& body(NPCValue& npc) {
+    return std::visit([](auto& creature) -> Body& { return creature; }, npc);
+}
+
+inline const Body& body(const NPCValue& npc) {
+    return std::visit([](const auto& creature) -> const Body& { return creature; }, npc);
+}
+
+inline const char* typeName(const NPCValue& npc) { return npcTypeInfo(typeOf(npc)).name; }
+inline const char* typeSymbol(const NPCValue& npc) { return npcTypeInfo(typeOf(npc)).symbol; }
+
+NPCValue make(NPCType type, double x, double y, const std::string& name);
+// Готовые поля, без поиска имени в таблице
+NPCValue make(NPCType type, const Body& data);
+// Формат строки совпадает с NPC::save
+void save(std::ostream& os, const NPCValue& npc);
+
+// Преобразования из обычной модели и обратно (через NPCFactory)
+NPCValue fromNPC(const NPC& npc);
+std::shared_ptr<NPC> toNPC(const NPCValue& npc);
+std::vector<NPCValue> fromNPCs(const std::vector<std::shared_ptr<NPC>>& npcs);
+std::vector<std::shared_ptr<NPC>> toNPCs(const std::vector<NPCValue>& npcs);
+
+} // namespace value
+
+#endif
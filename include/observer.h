@@ -6,33 +6,82 @@
 #include <memory>
 #include <mutex>
 #include <iostream>
+#include <sstream>
+#include <chrono>
+#include <unordered_set>
+#include <cstdint>
+#include "npc.h"
 
-// Observer интерфейс
+// Observer интерфейс. NPC передаются номерами (NPCRef), имя
+// разрешается через NameTable только там, где его выводят
 class Observer {
 public:
     virtual ~Observer() = default;
-    virtual void onFight(const std::string& attacker, const std::string& defender, bool defenderDied) = 0;
-    virtual void onMove(const std::string& npcName, double x, double y) = 0;
-    virtual void onDie(const std::string& npcName) = 0;
+    virtual void onFight(NPCRef attacker, NPCRef defender, bool defenderDied) = 0;
+    virtual void onMove(NPCRef npc, double x, double y) = 0;
+    virtual void onDie(NPCRef npc) = 0;
+    // Появление NPC и начало тика. Нужны для воспроизведения журнала
+    // (replay.h) и приходят, только если подземелье ведет запись
+    virtual void onSpawn(NPCRef npc, NPCType type, double x, double y, bool alive) {}
+    virtual void onTick(std::uint64_t tick) {}
+    // Уплотнение убрало NPC из мира; тоже только при записи
+    virtual void onRemove(NPCRef npc) {}
+    // Сбросить буферизованный вывод (вызывается один раз на пачку событий)
+    virtual void flush() {}
 };
 
 // Конкретные Observer'ы
 class ConsoleObserver : public Observer {
     std::mutex coutMutex;
 public:
-    void onFight(const std::string& attacker, const std::string& defender, bool defenderDied) override;
-    void onMove(const std::string& npcName, double x, double y) override;
-    void onDie(const std::string& npcName) override;
+    void onFight(NPCRef attacker, NPCRef defender, bool defenderDied) override;
+    void onMove(NPCRef npc, double x, double y) override;
+    void onDie(NPCRef npc) override;
+    void flush() override;
 };
 
+// Настройки журнала FileObserver
+struct FileLogConfig {
+    enum class Format { Text, Binary };
+
+    std::string path = "log.txt";
+    Format format = Format::Text;
+    size_t bufferSize = 0;     // Буфер в памяти, байт; 0 - писать в файл сразу
+    int flushIntervalMs = 0;   // Сбрасывать на диск не чаще; 0 - при каждом flush()
+    size_t rotateBytes = 0;    // Размер файла для ротации; 0 - без ротации
+    size_t keepFiles = 5;      // Сколько старых файлов хранить: path.1 ... path.N
+    bool truncate = false;     // Начать файл заново вместо дописывания
+};
+
+// Журнал в файл: текстовый (как раньше) или компактный двоичный
+// (см. event_log.h), с буферизацией и ротацией по размеру
 class FileObserver : public Observer {
+    FileLogConfig config;
     std::ofstream file;
+    std::ostringstream buffer;
     std::mutex fileMutex;
+    size_t fileBytes;
+    std::chrono::steady_clock::time_point lastFlush;
+    std::unordered_set<std::uint32_t> namedIds;  // NPC, чье имя уже записано в файл
+
+    void openFile(bool truncate);
+    void rotate();
+    void writeOut();
+    void beginRecord();
+    void endRecord();
+    std::uint32_t idFor(NPCRef npc);
+
 public:
     FileObserver();
-    void onFight(const std::string& attacker, const std::string& defender, bool defenderDied) override;
-    void onMove(const std::string& npcName, double x, double y) override;
-    void onDie(const std::string& npcName) override;
+    explicit FileObserver(const FileLogConfig& config);
+    ~FileObserver() override;
+    void onFight(NPCRef attacker, NPCRef defender, bool defenderDied) override;
+    void onMove(NPCRef npc, double x, double y) override;
+    void onDie(NPCRef npc) override;
+    void onSpawn(NPCRef npc, NPCType type, double x, double y, bool alive) override;
+    void onTick(std::uint64_t tick) override;
+    void onRemove(NPCRef npc) override;
+    void flush() override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Фазы, время которых меряет профилировщик
+enum class Phase : std::uint8_t {
+    Tick,           // Весь тик движения
+    Move,           // Шаги NPC
+    Reindex,        // Перенос переместившихся в сетке
+    Encounter,      // Поиск пар в радиусе атаки
+    FightSubmit,    // Ожидание места в очереди боев
+    FightDrain,     // Ожидание конца боев тика (без отрисовки)
+    FightResolve,   // Один бой
+    Dispatch,       // Доставка пачки событий наблюдателям
+    MapRender,      // Отрисовка карты
+    Snapshot,       // Публикация снимка мира
+    Compaction,
+    Count
+};
+
+// Величины, для которых хранится последнее и наибольшее значение
+enum class Gauge : std::uint8_t {
+    FightQueueDepth,
+    EventQueueDepth,
+    AliveNPCs,
+    Count
+};
+
+constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::Count);
+constexpr size_t GAUGE_COUNT = static_cast<size_t>(Gauge::Count);
+
+const char* phaseName(Phase phase);
+const char* gaugeName(Gauge gauge);
+
+// Гистограмма длительностей в наносекундах с логарифмическими корзинами:
+// до 16 нс - по корзине на наносекунду, дальше 8 корзин на каждую степень
+// двойки (погрешность квантиля не больше 1/8). Пишет один поток, читать
+// можно из любого.
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 16 + 8 * 44;
+
+    void record(std::uint64_t nanoseconds);
+    // Складывает значения в other (для сводки по потокам)
+    void mergeInto(LatencyHistogram& other) const;
+    void reset();
+
+    std::uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    std::uint64_t getSum() const { return sum.load(std::memory_order_relaxed); }
+    std::uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+    // Верхняя граница корзины, в которую попал квантиль q из [0, 1]
+    std::uint64_t quantile(double q) const;
+
+    static size_t bucketFor(std::uint64_t nanoseconds);
+    static std::uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint64_t> max{0};
+};
+
+// Сводка одной фазы по всем потокам
+struct PhaseSummary {
+    std::uint64_t count = 0;
+    double totalSeconds = 0;
+    double p50 = 0, p99 = 0, max = 0;  // В секундах
+};
+
+// Встроенный профилировщик фаз тика.
+// Каждый поток пишет в свои гистограммы (без общих блокировок и общих
+// строк кэша), сводка складывает их при чтении. Когда поток завершается,
+// его замеры переходят в общий итог завершившихся, а слот освобождается:
+// пулы, которые пересоздаются на каждом запуске, не копят память. Замеры ставятся макросами
+// PROFILE_SCOPE и PROFILE_GAUGE, которые без DUNGEON_PROFILER исчезают.
+// Дамп в текстовом формате Prometheus пишется рядом и подменяет файл
+// целиком, так что сборщик никогда не видит половину отчета.
+class Profiler {
+private:
+    struct ThreadSlot {
+        std::array<LatencyHistogram, PHASE_COUNT> phases;
+    };
+
+    // Владелец слота в thread_local: при выходе потока отдает слот обратно
+    struct SlotOwner {
+        Profiler* profiler = nullptr;
+        ThreadSlot* slot = nullptr;
+        ~SlotOwner();
+    };
+
+    std::mutex slotsMutex;
+    std::vector<std::unique_ptr<ThreadSlot>> slots;  // Слоты живых потоков
+    ThreadSlot retired;  // Замеры завершившихся потоков (под slotsMutex)
+
+    std::array<std::atomic<std::int64_t>, GAUGE_COUNT> gauges{};
+    std::array<std::atomic<std::int64_t>, GAUGE_COUNT> gaugeMax{};
+
+    std::string dumpPath;
+    std::chrono::milliseconds dumpInterval{1000};
+    std::thread dumper;
+    std::mutex dumperMutex;
+    std::condition_variable dumperCV;
+    bool dumperStopping = false;
+    std::atomic<std::uint64_t> dumps{0};
+
+    ThreadSlot& localSlot();
+    // Складывает замеры слота в retired и освобождает его
+    void retireSlot(ThreadSlot* slot);
+    void dumpLoop();
+
+public:
+    Profiler() = default;
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    static Profiler& global();
+
+    void record(Phase phase, std::uint64_t nanoseconds) {
+        localSlot().phases[static_cast<size_t>(phase)].record(nanoseconds);
+    }
+    void setGauge(Gauge gauge, std::int64_t value);
+
+    PhaseSummary summary(Phase phase);
+    std::int64_t getGauge(Gauge gauge) const;
+    std::int64_t getGaugeMax(Gauge gauge) const;
+
+    // Метрики в текстовом формате Prometheus
+    void writePrometheus(std::ostream& os);
+    bool dumpTo(const std::string& path);
+    // Периодический дамп из фонового потока; stopDump пишет последний
+    void startDump(const std::string& path, std::chrono::milliseconds interval);
+    void stopDump();
+    std::uint64_t getDumpCount() const { return dumps.load(); }
+
+    // Обнуляет гистограммы и датчики (потоки остаются зарегистрированы)
+    void reset();
+};
+
+// Замер области видимости: пишет длительность в фазу при выходе
+class ScopedTimer {
+private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Profiler::global().record(phase, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef DUNGEON_PROFILER
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(Phase::phase)
+#define PROFILE_GAUGE(gauge, value) Profiler::global().setGauge(Gauge::gauge, static_cast<std::int64_t>(value))
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_GAUGE(gauge, value) ((void)0)
+#endif
+
+#endif
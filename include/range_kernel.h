@@ -0,0 +1,48 @@
+#ifndef RANGE_KERNEL_H
+#define RANGE_KERNEL_H
+
+#include <cstdint>
+#include <cstddef>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Пакетная проверка "кандидат в радиусе атаки".
+// Один атакующий (x, y) сравнивается с блоком до RANGE_BLOCK кандидатов,
+// координаты которых лежат в двух отдельных массивах (SoA). Бит i
+// результата равен 1, если dx*dx + dy*dy <= radius2 для кандидата i.
+// Корень не извлекается: сравниваются квадраты расстояний.
+//
+// Реализации: скалярная, SSE2 (2 кандидата за команду) и AVX2 (4).
+// Все считают одно и то же выражение без FMA, поэтому маски совпадают
+// бит в бит и от выбора ядра не зависит воспроизводимый режим.
+
+const size_t RANGE_BLOCK = 64;
+
+enum class RangeKernel { Scalar, SSE2, AVX2 };
+
+// Лучшее ядро, доступное на этом процессоре (определяется один раз)
+RangeKernel activeRangeKernel();
+const char* rangeKernelName(RangeKernel kernel);
+// false, если ядро не собрано или процессор его не поддерживает
+bool rangeKernelSupported(RangeKernel kernel);
+
+// count <= RANGE_BLOCK; использует activeRangeKernel()
+std::uint64_t inRangeMask(double x, double y, double radius2,
+                          const double* xs, const double* ys, size_t count);
+// То же с явно выбранным ядром (для бенчмарка и сверки)
+std::uint64_t inRangeMask(RangeKernel kernel, double x, double y, double radius2,
+                          const double* xs, const double* ys, size_t count);
+
+// Номер младшего установленного бита (mask != 0)
+inline unsigned lowestBit(std::uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+#endif
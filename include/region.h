@@ -0,0 +1,69 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "world_config.h"
+#include "npc.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Прогон, в котором мир разрезан на вертикальные полосы (регионы), и
+// каждую полосу ведет свое подземелье в отдельном процессе.
+// Родитель создает всех NPC (как spawnRandomNPCs с тем же зерном),
+// запускает процессы через fork и связывает соседей парами Unix-сокетов.
+// Каждый тик регион делает ходы и отдает соседям ушедших к ним NPC,
+// затем решает бои своих атакующих. После этого он вторым обменом отдает
+// соседям копии своих выживших атакующих у общей границы (не дальше
+// наибольшей дистанции убийства). Полученные копии становятся призраками:
+// они атакуют своих NPC в отдельной фазе. Бой с защитником всегда решает
+// регион, которому защитник принадлежит, а атакующий, погибший дома в
+// этом тике, у соседа уже не бьет.
+// Ширина полосы должна быть не меньше суммы наибольших дистанций хода и
+// убийства. Тогда NPC за тик уходит только в соседнюю полосу и атаковать
+// может только из соседней.
+// Бои призраков идут после своих, поэтому результат воспроизводим для
+// пары (зерно, число регионов), но с разным числом регионов немного
+// различается. Один регион совпадает с --headless.
+struct RegionConfig {
+    WorldConfig world;
+    size_t regions = 2;
+    std::uint64_t ticks = 1000;
+    bool seeded = false;
+    unsigned seed = 0;
+    bool deterministic = false;
+    size_t threadsPerRegion = 1;   // Потоков движения и боев в каждом процессе
+    double compactDeadFraction = 0.5;
+};
+
+// Итоги одного региона
+struct RegionStats {
+    double minX = 0, maxX = 0;      // Полоса [minX, maxX)
+    size_t total = 0;               // NPC в конце прогона
+    size_t alive = 0;
+    std::uint64_t migratedOut = 0;  // Ушло в соседние регионы
+    std::uint64_t ghostsSent = 0;   // Отправлено копий у границы
+    std::uint64_t bytesSent = 0;
+    double wallSeconds = 0;
+    double exchangeSeconds = 0;     // Из них - обмен с соседями
+};
+
+// Итоги прогона по всем регионам
+struct RegionReport {
+    std::uint64_t ticks = 0;
+    double wallSeconds = 0;         // Самый медленный регион
+    double ticksPerSecond = 0;
+    std::uint64_t fights = 0;
+    size_t alive = 0;
+    size_t total = 0;
+    // Хеш мира по возрастанию id - как Dungeon::stateChecksum
+    std::uint64_t checksum = 0;
+    std::array<std::array<std::uint64_t, NPC_TYPE_COUNT>, NPC_TYPE_COUNT> killsByPair{};
+    std::vector<RegionStats> regions;
+};
+
+// Запускает процессы регионов и ждет их; false и текст в error, если
+// настройки не подходят, платформа без fork или процесс региона упал
+bool runRegions(const RegionConfig& config, RegionReport& report, std::string& error);
+
+#endif
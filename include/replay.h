@@ -0,0 +1,84 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "event_log.h"
+#include "npc_value.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Мир, восстановленный по двоичному журналу событий
+struct ReplayState {
+    std::uint64_t tick = 0;  // Последний завершенный тик
+    std::uint64_t fights = 0;
+    std::array<std::array<std::uint64_t, NPC_TYPE_COUNT>, NPC_TYPE_COUNT> killsByPair{};
+    std::vector<value::NPCValue> npcs;  // Индекс - id NPC
+    std::vector<std::uint8_t> present;  // Есть ли NPC с таким id
+
+    // Применяет одно событие; имена берутся из таблицы читателя
+    void apply(const LogRecord& record, const EventLogReader& reader);
+
+    size_t getNPCCount() const;
+    size_t getAliveCount() const;
+    size_t getAliveCount(NPCType type) const;
+    // Присутствующие NPC по возрастанию id - в том же порядке, что в подземелье
+    std::vector<value::NPCValue> world() const;
+    // Совпадает с Dungeon::stateChecksum для того же мира
+    std::uint64_t checksum() const;
+    // Приблизительный объем памяти копии мира (для ключевых кадров)
+    size_t memoryBytes() const;
+};
+
+// Повтор записанного прогона (Dungeon::setRecording).
+// open читает журнал один раз и запоминает ключевые кадры - копии мира
+// на конец каждого keyframeInterval-го тика вместе с позицией в файле.
+// seek восстанавливает ближайший кадр не позже нужного тика и дочитывает
+// журнал только от него, а движение вперед от текущего тика кадров не
+// требует вовсе. Так любой тик многочасового прогона достижим без
+// повторного чтения с начала.
+// Кадры вместе не занимают больше keyframeBudget байт: при превышении
+// каждый второй кадр выбрасывается, а интервал удваивается. Поиск тогда
+// дочитывает больше записей, но память не растет с длиной прогона.
+class ReplayEngine {
+private:
+    struct Keyframe {
+        std::uint64_t tick;
+        std::uint64_t offset;  // Запись Tick(tick + 1)
+        ReplayState state;
+    };
+
+    std::uint64_t keyframeInterval;
+    size_t keyframeBudget;
+    size_t keyframeBytes;       // Сумма memoryBytes всех кадров
+    EventLogReader reader;
+    std::vector<Keyframe> keyframes;
+    ReplayState state;
+    std::uint64_t firstTick;
+    std::uint64_t lastTick;
+    std::uint64_t position;     // Первая непримененная запись для state
+    std::uint64_t recordsRead;  // Прочитано записей последним seek
+
+    void addKeyframe(std::uint64_t offset);
+
+public:
+    static const size_t DEFAULT_KEYFRAME_BUDGET = 256u << 20;
+
+    explicit ReplayEngine(std::uint64_t keyframeInterval = 100, size_t keyframeBudget = DEFAULT_KEYFRAME_BUDGET);
+
+    // false, если это не двоичный журнал или в нем нет записи появлений
+    bool open(const std::string& path);
+    // Мир на конец тика tick; false, если тик вне записанного диапазона
+    bool seek(std::uint64_t tick);
+
+    const ReplayState& getState() const { return state; }
+    std::uint64_t getFirstTick() const { return firstTick; }
+    std::uint64_t getLastTick() const { return lastTick; }
+    size_t getKeyframeCount() const { return keyframes.size(); }
+    size_t getKeyframeBytes() const { return keyframeBytes; }
+    // Интервал после прореживания кадров может быть больше заданного
+    std::uint64_t getKeyframeInterval() const { return keyframeInterval; }
+    std::uint64_t getRecordsRead() const { return recordsRead; }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Scheduler;
+
+// Задача-сопрограмма без результата. Создается приостановленной и
+// начинает работу только после Scheduler::spawn; кадр освобождается сам,
+// когда сопрограмма завершилась, или при остановке планировщика, если она
+// так и осталась ждать. Исключение из задачи - ошибка программы (terminate)
+class Task {
+public:
+    struct promise_type {
+        Scheduler* scheduler = nullptr;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept;
+        ~promise_type();
+    };
+
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    friend class Scheduler;
+};
+
+// Кооперативный планировщик сопрограмм.
+// Небольшой постоянный пул потоков выполняет готовые задачи из общей
+// очереди (забирая их пачками), а задержки отсчитывает колесо таймеров:
+// кольцо из WHEEL_SLOTS ячеек по resolution каждая, отдельный поток
+// проворачивает его и переносит наступившие сроки в очередь. Спящая задача
+// - это только кадр сопрограммы и запись в ячейке, без своего потока,
+// поэтому ждать могут миллионы задач сразу. Задача, которая долго
+// работает без co_await, занимает поток пула целиком.
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static const size_t WHEEL_SLOTS = 1024;
+    static const size_t BATCH_SIZE = 64;
+
+    // Ожидание: срок уже наступил - сопрограмма идет дальше без остановки
+    struct SleepAwaiter {
+        Scheduler& scheduler;
+        Clock::time_point when;
+
+        bool await_ready() const { return when <= Clock::now(); }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.addTimer(handle, when); }
+        void await_resume() const noexcept {}
+    };
+
+    // Уступить поток: задача встает в конец очереди готовых
+    struct YieldAwaiter {
+        Scheduler& scheduler;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.post(handle); }
+        void await_resume() const noexcept {}
+    };
+
+private:
+    struct Timer {
+        std::coroutine_handle<> handle;
+        std::uint64_t due;  // Номер шага колеса (от wheelStart), на котором пора будить
+    };
+
+    const size_t threadCount;
+    std::vector<std::thread> workers;
+    std::mutex readyMutex;
+    std::condition_variable readyCV;
+    std::deque<std::coroutine_handle<>> ready;
+
+    // Колесо таймеров
+    std::thread timerThread;
+    std::mutex wheelMutex;
+    std::condition_variable wheelCV;
+    std::array<std::vector<Timer>, WHEEL_SLOTS> wheel;
+    Clock::time_point wheelStart;
+    Clock::duration resolution;
+    std::uint64_t wheelTick;   // Последняя обработанная ячейка (от wheelStart)
+    size_t timerCount;
+
+    std::atomic<bool> stopping;
+    std::atomic<size_t> liveTasks;
+    std::atomic<std::uint64_t> resumed;
+    std::mutex stopMutex;
+
+    void post(std::coroutine_handle<> handle);
+    void postBatch(std::vector<std::coroutine_handle<>>& handles);
+    void addTimer(std::coroutine_handle<> handle, Clock::time_point when);
+    void workerLoop();
+    void timerLoop();
+    // Переносит в expired наступившие сроки ячеек (wheelTick, upTo]
+    void advanceWheel(std::uint64_t upTo, std::vector<std::coroutine_handle<>>& expired);
+
+    friend struct Task::promise_type;
+
+public:
+    explicit Scheduler(size_t threads, Clock::duration resolution = std::chrono::milliseconds(1));
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Ставит задачу в очередь; после stop задача сразу уничтожается
+    void spawn(Task task);
+    // Останавливает потоки и уничтожает все ждущие задачи. Задачи, которые
+    // сейчас выполняются, доходят до ближайшего co_await. Не вызывать из задачи
+    void stop();
+    bool isStopping() const { return stopping.load(std::memory_order_relaxed); }
+
+    SleepAwaiter sleepUntil(Clock::time_point when) { return SleepAwaiter{*this, when}; }
+    SleepAwaiter sleepFor(Clock::duration delay) { return SleepAwaiter{*this, Clock::now() + delay}; }
+    YieldAwaiter yield() { return YieldAwaiter{*this}; }
+
+    size_t size() const { return threadCount; }
+    // Созданные и еще не завершенные задачи (готовые, спящие и выполняемые)
+    size_t getLiveTasks() const { return liveTasks.load(std::memory_order_relaxed); }
+    std::uint64_t getResumed() const { return resumed.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "npc_store.h"
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Двоичный снимок мира.
+//
+// Файл состоит из заголовка и массивов, выровненных по 8 байт:
+//   types[count]        uint8  тег типа
+//   alive[count]        uint8  флаг жизни
+//   x[count], y[count]  double координаты
+//   nameIndex[count]    uint32 номер имени в таблице строк
+//   ids[count]          uint32 постоянный номер NPC (с версии 2)
+//   nameOffsets[names+1] uint64 начало каждого имени в байтах строк
+//   nameBytes           UTF-8 байты всех имен подряд
+// Порядок байт - как на хосте. Массивы лежат в том же виде, что и в
+// NPCStore, поэтому загрузка - это отображение файла в память и
+// копирование массивов целиком, без разбора отдельных записей. Только
+// номера имен в файле свои: при загрузке каждое имя один раз вносится
+// в NameTable, а номера переводятся по получившейся таблице.
+// Файлы версии 1 (без номеров NPC) тоже читаются.
+const char SNAPSHOT_MAGIC[4] = {'D', 'S', 'N', 'P'};
+const std::uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint64_t nameCount;
+    std::uint64_t typesOffset;
+    std::uint64_t aliveOffset;
+    std::uint64_t xOffset;
+    std::uint64_t yOffset;
+    std::uint64_t nameIndexOffset;
+    std::uint64_t nameOffsetsOffset;
+    std::uint64_t nameBytesOffset;
+    std::uint64_t nameBytesSize;
+    std::uint64_t idsOffset;  // С версии 2
+};
+
+// Заголовок версии 1 заканчивается перед idsOffset
+const size_t SNAPSHOT_V1_HEADER_SIZE = offsetof(SnapshotHeader, idsOffset);
+
+// Возвращают false при ошибке ввода-вывода или поврежденном файле
+bool saveSnapshot(const NPCStore& store, const std::string& filename);
+bool loadSnapshot(const std::string& filename, NPCStore& store);
+
+// Проверяет сигнатуру, не загружая файл
+bool isSnapshotFile(const std::string& filename);
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "npc.h"
+#include "range_kernel.h"
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Равномерная сетка для поиска NPC в радиусе атаки.
+// Размер ячейки берется равным максимальной дистанции убийства,
+// поэтому для любого NPC достаточно просмотреть соседние ячейки 3x3.
+// Позиции обновляются в NPC::move, так что индекс всегда актуален.
+// Рядом с указателями каждая ячейка хранит копии координат отдельными
+// массивами: проверка радиуса идет блоками через inRangeMask без
+// обращения к самим NPC.
+class SpatialGrid {
+public:
+    // Предел числа ячеек; при большем ячейки укрупняются
+    static constexpr double MAX_CELLS = 1 << 20;
+
+private:
+    double width, height;
+    double cellSize;
+    int cols, rows;
+    std::vector<std::vector<NPC*>> cells;
+    std::vector<std::vector<double>> cellXs, cellYs;  // Параллельно cells
+    size_t count;
+
+    int cellX(double x) const;
+    int cellY(double y) const;
+    int cellIndex(double x, double y) const { return cellY(y) * cols + cellX(x); }
+    void removeFromCell(NPC* npc);
+    void addToCell(NPC* npc, int cell);
+
+public:
+    SpatialGrid(double width, double height, double cellSize);
+    ~SpatialGrid();
+
+    SpatialGrid(const SpatialGrid&) = delete;
+    SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+    // Перестраивает сетку с новым размером ячейки, сохраняя NPC
+    void resize(double newCellSize);
+    // То же для мира новых размеров
+    void reshape(double newWidth, double newHeight, double newCellSize);
+    void insert(NPC* npc);
+    void remove(NPC* npc);
+    void update(NPC* npc);
+    void clear();
+
+    size_t size() const { return count; }
+    double getCellSize() const { return cellSize; }
+    double getWidth() const { return width; }
+    double getHeight() const { return height; }
+
+    // Вызывает fn(NPC*) для каждого NPC на расстоянии не больше radius от (x, y)
+    template <typename Fn>
+    void forEachInRange(double x, double y, double radius, Fn&& fn) const {
+        int x0 = cellX(x - radius), x1 = cellX(x + radius);
+        int y0 = cellY(y - radius), y1 = cellY(y + radius);
+        double r2 = radius * radius;
+
+        for (int cy = y0; cy <= y1; ++cy) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                const int cell = cy * cols + cx;
+                NPC* const* npcs = cells[cell].data();
+                const double* xs = cellXs[cell].data();
+                const double* ys = cellYs[cell].data();
+                const size_t size = cells[cell].size();
+
+                for (size_t base = 0; base < size; base += RANGE_BLOCK) {
+                    size_t block = std::min(RANGE_BLOCK, size - base);
+                    std::uint64_t mask = inRangeMask(x, y, r2, xs + base, ys + base, block);
+                    while (mask) {
+                        fn(npcs[base + lowestBit(mask)]);
+                        mask &= mask - 1;
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif
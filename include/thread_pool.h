@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+// Пул потоков для параллельных фаз тика.
+// Пул из N участников держит N-1 фоновых потоков: нулевой участок
+// работы выполняет вызывающий поток, поэтому при N = 1 все идет
+// без переключений контекста.
+class ThreadPool {
+public:
+    // fn(begin, end, worker): обработать элементы [begin, end) участником worker
+    using RangeFn = std::function<void(size_t begin, size_t end, size_t worker)>;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable startCV;
+    std::condition_variable doneCV;
+
+    // Текущее задание
+    const RangeFn* job;
+    size_t jobCount;
+    size_t jobChunks;
+    size_t generation;  // Номер задания, чтобы потоки не выполнили его дважды
+    size_t pending;     // Сколько фоновых участков еще не завершено
+    bool stopping;
+
+    void workerLoop(size_t worker);
+    void runChunk(size_t chunk);
+
+public:
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads.size() + 1; }
+
+    // Делит [0, count) на участки не меньше minChunk и ждет их завершения.
+    // Участник с номером worker всегда получает один и тот же участок.
+    void parallelFor(size_t count, size_t minChunk, const RangeFn& fn);
+};
+
+#endif
@@ -13,7 +13,7 @@ private:
 
 public:
     void addObserver(std::shared_ptr<Observer> observer);
-    void notifyObservers(const std::string& attacker, const std::string& defender, bool defenderDied);
+    void notifyObservers(NPCRef attacker, NPCRef defender, bool defenderDied);
     
     // Правила для варианта 20
     void visit(Dragon& dragon, NPC& other);
@@ -0,0 +1,50 @@
+#ifndef WORLD_CONFIG_H
+#define WORLD_CONFIG_H
+
+#include "npc.h"
+#include "factory.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Параметры мира: размеры, население и правила хода.
+// Значения по умолчанию совпадают с исходной игрой (100x100, 50 NPC,
+// дистанции из NPC_TYPE_INFO), поэтому без настроек ничего не меняется.
+// Читается из файла строками "ключ = значение" (# - комментарий)
+// и теми же парами из командной строки:
+//   width, height          размеры мира
+//   npcs                   сколько NPC создать при старте
+//   mix.<Тип>              относительная доля типа при создании
+//   move.<Тип>, kill.<Тип> дистанции хода и убийства
+//   map.columns, map.rows  разрешение карты в обычной игре
+struct WorldConfig {
+    double width = 100;
+    double height = 100;
+    size_t spawnCount = 50;
+    std::array<double, NPC_TYPE_COUNT> typeMix;
+    std::array<int, NPC_TYPE_COUNT> moveDistance;
+    std::array<int, NPC_TYPE_COUNT> killDistance;
+    int mapColumns = 10;
+    int mapRows = 10;
+
+    WorldConfig();
+
+    WorldBounds bounds() const { return WorldBounds{width, height}; }
+    SpawnRegion spawnRegion() const { return SpawnRegion{0, 0, width, height}; }
+    std::vector<double> typeWeights() const { return {typeMix.begin(), typeMix.end()}; }
+    int getMaxKillDistance() const;
+
+    // Применяет одну пару; false и текст в error, если ключ или значение неверны
+    bool set(const std::string& key, const std::string& value, std::string& error);
+    // Пара вида "ключ=значение" (для --set)
+    bool set(const std::string& assignment, std::string& error);
+    // Читает файл поверх текущих значений; error содержит номер строки
+    bool load(const std::string& path, std::string& error);
+    // Проверяет согласованность значений после всех set/load
+    bool validate(std::string& error) const;
+    // Пишет настройки в формате, который читает load
+    void save(std::ostream& os) const;
+};
+
+#endif
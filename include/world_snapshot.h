@@ -0,0 +1,67 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include "npc_value.h"
+#include "dungeon_stats.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+// Неизменяемая копия мира на конец тика: NPC в виде значений (npc_value.h)
+// и счетчики. Читатели (карта, сохранение, статистика) работают с ней,
+// не блокируя подземелье и не видя NPC посреди хода.
+struct WorldSnapshot {
+    std::uint64_t epoch = 0;  // Номер публикации
+    std::uint64_t tick = 0;
+    std::vector<value::NPCValue> npcs;
+    StatsSnapshot stats;
+};
+
+// Публикация снимков с тройной буферизацией.
+// Писатель заполняет свободный буфер и одной атомарной записью номера
+// делает его текущим. Читатель без блокировок: отмечает буфер в pinned,
+// проверяет, что тот все еще текущий, и копирует его shared_ptr. Буфер
+// свободен, когда он не текущий, никто его не отмечает и на него нет
+// ссылок, кроме самой таблицы буферов. Если все три заняты медленными
+// читателями, выделяется новый, а старый доживает у читателей. Так память
+// под NPC переиспользуется от тика к тику.
+class WorldSnapshotBuffer {
+private:
+    static const size_t BUFFER_COUNT = 3;
+
+    std::array<std::shared_ptr<WorldSnapshot>, BUFFER_COUNT> buffers;
+    // Читатели, которые прямо сейчас копируют указатель буфера
+    mutable std::array<std::atomic<std::uint32_t>, BUFFER_COUNT> pinned;
+    std::atomic<size_t> current;
+    // Писатель один: тик движения или ленивая публикация из читателя
+    std::mutex writerMutex;
+    std::uint64_t epoch;
+    size_t allocations;
+
+    size_t acquireFree();
+
+public:
+    WorldSnapshotBuffer();
+
+    // Заполняет свободный буфер через fill(WorldSnapshot&) и публикует его
+    template <typename Fill>
+    void publish(Fill&& fill) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        size_t index = acquireFree();
+        WorldSnapshot& snapshot = *buffers[index];
+        fill(snapshot);
+        snapshot.epoch = ++epoch;
+        current.store(index);
+    }
+
+    // Последний опубликованный снимок (пустой, если публикаций не было).
+    // Без блокировок: писатель никогда не трогает отмеченный буфер
+    std::shared_ptr<const WorldSnapshot> acquire() const;
+    // Сколько раз пришлось выделять буфер (3 - все буферы переиспользуются)
+    size_t getAllocations() const { return allocations; }
+};
+
+#endif
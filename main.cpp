@@ -2,9 +2,15 @@
 #include <chrono>
 #include <thread>
 #include <csignal>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 #include "include/dungeon.h"
 #include "include/factory.h"
 #include "include/observer.h"
+#include "include/profiler.h"
+#include "include/region.h"
 
 // Глобальная переменная для обработки сигналов
 Dungeon* globalDungeon = nullptr;
@@ -12,19 +18,362 @@ Dungeon* globalDungeon = nullptr;
 // Обработчик сигналов
 void signalHandler(int signal) {
     if (globalDungeon && signal == SIGINT) {
-        std::cout << "\nПолучен сигнал прерывания. Завершаем игру..." << std::endl;
-        globalDungeon->stopGame();
+        // Здесь только просим остановиться, потоки присоединит main
+        globalDungeon->requestStop();
     }
 }
 
-int main() {
+// Параметры командной строки
+struct Options {
+    bool headless = false;
+    std::uint64_t ticks = 1000;
+    // Мир: файл настроек и пары ключ=значение поверх него (по порядку)
+    std::string config;
+    std::vector<std::string> worldSettings;
+    bool printConfig = false;
+    bool seeded = false;
+    unsigned seed = 0;
+    bool deterministic = false;
+    size_t threads = 0;  // 0 - по числу ядер
+    int duration = 30;
+    double compact = 0.5;  // Доля погибших для уплотнения, 0 - без него
+    std::string checkpoint;  // Файл контрольных точек (пусто - без них)
+    std::uint64_t checkpointEvery = 100;
+    std::string resume;      // Продолжить с точки из этого файла
+    std::string resumeLog;   // Журнал (--record) того же прогона, догоняющий точку
+    std::string loadSnapshot;  // Начать с мира из двоичного снимка
+    std::string saveSnapshot;  // Сохранить итоговый мир в двоичный снимок
+    std::string record;      // Двоичный журнал для dungeon_replay
+    std::string metrics;     // Файл метрик в формате Prometheus
+    std::uint64_t metricsEvery = 1000;  // Мс между дампами метрик
+    size_t regions = 0;      // Процессов-регионов (0 - одно подземелье)
+    NPCStorage storage = NPCStorage::Objects;
+};
+
+void printUsage(const char* program) {
+    std::cout << "Использование: " << program << " [параметры]\n"
+              << "  --headless      прогон без карты и пауз, с отчетом о скорости\n"
+              << "  --ticks N       число тиков в режиме --headless (1000)\n"
+              << "  --npcs N        число NPC (50)\n"
+              << "  --config F      настройки мира из файла F (строки ключ = значение)\n"
+              << "  --width W, --height H  размеры мира (100 x 100)\n"
+              << "  --set K=V       любой параметр мира, например mix.Toad=5 или kill.Dragon=40\n"
+              << "  --print-config  напечатать итоговые настройки мира и выйти\n"
+              << "  --seed S        зерно генераторов случайных чисел\n"
+              << "  --deterministic результат зависит только от зерна, не от числа потоков\n"
+              << "  --threads N     потоков фазы движения (по числу ядер)\n"
+              << "  --duration S    длительность обычной игры в секундах (30)\n"
+              << "  --compact F     убирать погибших, когда их доля достигла F (0.5, 0 - никогда)\n"
+              << "  --checkpoint P  фоновые контрольные точки в файл P\n"
+              << "  --checkpoint-every N  тиков между точками (100)\n"
+              << "  --resume P      продолжить с последней точки файла P\n"
+              << "  --resume-log P  догнать точку по двоичному журналу P того же прогона\n"
+              << "  --load-snapshot P  начать с мира из двоичного снимка P вместо новых NPC\n"
+              << "  --save-snapshot P  сохранить мир в конце игры в двоичный снимок P\n"
+              << "  --record P      записать прогон в двоичный журнал P для dungeon_replay\n"
+              << "  --metrics P     периодически писать метрики фаз тика в P (формат Prometheus)\n"
+              << "  --metrics-every MS  мс между дампами метрик (1000)\n"
+              << "  --regions N     прогон без отрисовки в N процессах, по полосе мира на каждый\n"
+              << "  --storage S     objects или columns: откуда движение и карта берут NPC (objects)\n";
+}
+
+// Разбирает аргументы; false - нужно завершиться (справка или ошибка)
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--ticks" && hasValue) {
+            options.ticks = std::stoull(argv[++i]);
+        } else if (arg == "--npcs" && hasValue) {
+            options.worldSettings.push_back(std::string("npcs=") + argv[++i]);
+        } else if (arg == "--config" && hasValue) {
+            options.config = argv[++i];
+        } else if (arg == "--width" && hasValue) {
+            options.worldSettings.push_back(std::string("width=") + argv[++i]);
+        } else if (arg == "--height" && hasValue) {
+            options.worldSettings.push_back(std::string("height=") + argv[++i]);
+        } else if (arg == "--set" && hasValue) {
+            options.worldSettings.push_back(argv[++i]);
+        } else if (arg == "--print-config") {
+            options.printConfig = true;
+        } else if (arg == "--seed" && hasValue) {
+            options.seeded = true;
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--deterministic") {
+            options.deterministic = true;
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::stoull(argv[++i]);
+        } else if (arg == "--duration" && hasValue) {
+            options.duration = std::stoi(argv[++i]);
+        } else if (arg == "--compact" && hasValue) {
+            options.compact = std::stod(argv[++i]);
+        } else if (arg == "--checkpoint" && hasValue) {
+            options.checkpoint = argv[++i];
+        } else if (arg == "--checkpoint-every" && hasValue) {
+            options.checkpointEvery = std::stoull(argv[++i]);
+        } else if (arg == "--resume" && hasValue) {
+            options.resume = argv[++i];
+        } else if (arg == "--resume-log" && hasValue) {
+            options.resumeLog = argv[++i];
+        } else if (arg == "--load-snapshot" && hasValue) {
+            options.loadSnapshot = argv[++i];
+        } else if (arg == "--save-snapshot" && hasValue) {
+            options.saveSnapshot = argv[++i];
+        } else if (arg == "--record" && hasValue) {
+            options.record = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            options.metrics = argv[++i];
+        } else if (arg == "--metrics-every" && hasValue) {
+            options.metricsEvery = std::stoull(argv[++i]);
+        } else if (arg == "--regions" && hasValue) {
+            options.regions = std::stoull(argv[++i]);
+        } else if (arg == "--storage" && hasValue) {
+            std::string storage = argv[++i];
+            if (storage == "objects") {
+                options.storage = NPCStorage::Objects;
+            } else if (storage == "columns") {
+                options.storage = NPCStorage::Columns;
+            } else {
+                std::cerr << "Неизвестное хранилище: " << storage << "\n";
+                printUsage(argv[0]);
+                return false;
+            }
+        } else {
+            if (arg != "--help" && arg != "-h") {
+                std::cerr << "Неизвестный параметр: " << arg << "\n";
+            }
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// p50 / p99 / max фаз, которые выполнялись хотя бы раз
+void printPhases() {
+#ifdef DUNGEON_PROFILER
+    std::cout << "Фазы (p50 / p99 / max, мс):\n";
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        PhaseSummary phase = Profiler::global().summary(static_cast<Phase>(i));
+        if (phase.count == 0) continue;
+        std::cout << "  " << phaseName(static_cast<Phase>(i)) << ": " << phase.p50 * 1e3 << " / "
+                  << phase.p99 * 1e3 << " / " << phase.max * 1e3 << " (" << phase.count << " замеров)\n";
+    }
+    std::cout << "Очередь боев: до " << Profiler::global().getGaugeMax(Gauge::FightQueueDepth)
+              << ", событий: до " << Profiler::global().getGaugeMax(Gauge::EventQueueDepth) << "\n";
+#endif
+}
+
+// Файл настроек, затем параметры командной строки; false - ошибка уже выведена
+bool buildWorldConfig(const Options& options, WorldConfig& config) {
+    std::string error;
+    if (!options.config.empty() && !config.load(options.config, error)) {
+        std::cerr << "Ошибка в настройках мира: " << error << std::endl;
+        return false;
+    }
+    for (const std::string& setting : options.worldSettings) {
+        if (!config.set(setting, error)) {
+            std::cerr << "Ошибка в настройках мира: " << error << std::endl;
+            return false;
+        }
+    }
+    if (!config.validate(error)) {
+        std::cerr << "Ошибка в настройках мира: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Итоговый мир в двоичный снимок, если он запрошен; false - ошибка уже выведена
+bool saveFinalSnapshot(const Dungeon& dungeon, const Options& options) {
+    if (options.saveSnapshot.empty()) return true;
+    if (!dungeon.saveSnapshot(options.saveSnapshot)) {
+        std::cerr << "Не удалось сохранить снимок: " << options.saveSnapshot << std::endl;
+        return false;
+    }
+    std::cout << "Снимок мира сохранен в " << options.saveSnapshot << std::endl;
+    return true;
+}
+
+int runHeadless(Dungeon& dungeon, const Options& options) {
+    // Журнал пишется крупными блоками, консоль не используется
+    FileLogConfig logConfig;
+    logConfig.bufferSize = 1 << 20;
+    logConfig.flushIntervalMs = 1000;
+    dungeon.addObserver(std::make_shared<FileObserver>(logConfig));
+    
+    const WorldConfig& world = dungeon.getWorldConfig();
+    if (options.resume.empty() && options.loadSnapshot.empty()) {
+        dungeon.spawnRandomNPCs(world.spawnCount);
+    }
+    std::cout << "Прогон без отрисовки: " << dungeon.getNPCCount() << " NPC в мире " << world.width << "x"
+              << world.height << ", " << options.ticks << " тиков..." << std::endl;
+    
+    HeadlessReport report = dungeon.runHeadless(options.ticks);
+    
+    std::cout << "Тиков выполнено: " << report.ticks << "\n"
+              << "Время: " << report.wallSeconds << " с\n"
+              << "Тиков в секунду: " << report.ticksPerSecond << "\n"
+              << "Боев проведено: " << report.fights << "\n"
+              << "Всего живых: " << report.alive << " из " << report.total << "\n"
+              << "Уплотнений: " << report.compactions << " (убрано погибших: " << report.removed
+              << ", " << report.compactionMilliseconds << " мс)\n"
+              << "Байт на NPC: " << report.bytesPerNPC << "\n"
+              << "Контрольная сумма: " << std::hex << report.checksum << std::dec << "\n";
+    printPhases();
+    
+    if (const Checkpointer* checkpointer = dungeon.getCheckpointer()) {
+        std::cout << "Контрольных точек: " << checkpointer->getWritten() << " (пропущено "
+                  << checkpointer->getSkipped() << ", ошибок " << checkpointer->getFailed() << ", байт " << checkpointer->getBytesWritten()
+                  << ", последняя - тик " << checkpointer->getLastTick() << ")\n";
+    }
+    
+    // Убийства по парам типов из счетчиков подземелья
+    StatsSnapshot stats = dungeon.getStats();
+    std::cout << "Убийств:";
+    for (const AttackRule& rule : ATTACK_RULES) {
+        std::cout << " " << npcTypeInfo(rule.attacker).name << "->" << npcTypeInfo(rule.defender).name << " "
+                  << stats.killsByPair[static_cast<size_t>(rule.attacker)][static_cast<size_t>(rule.defender)];
+    }
+    std::cout << "\n";
+    // Смерти по последним тикам из истории счетчиков
+    const size_t shown = std::min<size_t>(stats.deathsHistorySize, 10);
+    std::cout << "Смертей за последние " << shown << " тиков:";
+    for (size_t i = stats.deathsHistorySize - shown; i < stats.deathsHistorySize; ++i) {
+        std::cout << " " << stats.deathsHistory[i];
+    }
+    std::cout << std::endl;
+    return saveFinalSnapshot(dungeon, options) ? 0 : 1;
+}
+
+int runRegionMode(const WorldConfig& world, const Options& options) {
+    RegionConfig config;
+    config.world = world;
+    config.regions = options.regions;
+    config.ticks = options.ticks;
+    config.seeded = options.seeded;
+    config.seed = options.seed;
+    config.deterministic = options.deterministic;
+    config.threadsPerRegion = std::max<size_t>(1, options.threads);
+    config.compactDeadFraction = options.compact;
+
+    std::cout << "Прогон в " << config.regions << " регионах: " << world.spawnCount << " NPC в мире "
+              << world.width << "x" << world.height << ", " << config.ticks << " тиков..." << std::endl;
+    RegionReport report;
+    std::string error;
+    if (!runRegions(config, report, error)) {
+        std::cerr << "Ошибка режима регионов: " << error << std::endl;
+        return 1;
+    }
+
+    std::cout << "Тиков выполнено: " << report.ticks << "\n"
+              << "Время: " << report.wallSeconds << " с\n"
+              << "Тиков в секунду: " << report.ticksPerSecond << "\n"
+              << "Боев проведено: " << report.fights << "\n"
+              << "Всего живых: " << report.alive << " из " << report.total << "\n"
+              << "Контрольная сумма: " << std::hex << report.checksum << std::dec << "\n";
+    for (size_t i = 0; i < report.regions.size(); ++i) {
+        const RegionStats& region = report.regions[i];
+        std::cout << "  Регион " << i << " [" << region.minX << ", " << region.maxX << "): "
+                  << region.alive << " живых из " << region.total << ", ушло " << region.migratedOut
+                  << ", копий у границы " << region.ghostsSent << ", байт " << region.bytesSent
+                  << ", обмен " << region.exchangeSeconds << " из " << region.wallSeconds << " с\n";
+    }
+    std::cout << "Убийств:";
+    for (const AttackRule& rule : ATTACK_RULES) {
+        std::cout << " " << npcTypeInfo(rule.attacker).name << "->" << npcTypeInfo(rule.defender).name << " "
+                  << report.killsByPair[static_cast<size_t>(rule.attacker)][static_cast<size_t>(rule.defender)];
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
     try {
+        Options options;
+        if (!parseOptions(argc, argv, options)) {
+            return 1;
+        }
+        WorldConfig world;
+        if (!buildWorldConfig(options, world)) {
+            return 1;
+        }
+        if (options.printConfig) {
+            world.save(std::cout);
+            return 0;
+        }
+        if (options.regions > 0) {
+            // До создания потоков: процессы регионов создаются через fork
+            return runRegionMode(world, options);
+        }
+        
         Dungeon dungeon;
         globalDungeon = &dungeon;
         
         // Устанавливаем обработчик сигналов
         std::signal(SIGINT, signalHandler);
         
+        if (options.seeded || options.deterministic) {
+            dungeon.setSeed(options.seed);
+        }
+        dungeon.setDeterministic(options.deterministic);
+        dungeon.setStorage(options.storage);
+        if (options.threads > 0) {
+            dungeon.setMovementThreads(options.threads);
+        }
+        dungeon.setWorldConfig(world);
+        dungeon.setGameDuration(options.duration);
+        dungeon.setCompaction(options.compact, 64);
+        
+        if (!options.resume.empty()) {
+            if (!dungeon.resumeFromCheckpoint(options.resume, options.resumeLog)) {
+                std::cerr << "Не удалось прочитать контрольную точку: " << options.resume;
+                if (!options.resumeLog.empty()) std::cerr << " или догнать ее по журналу " << options.resumeLog;
+                std::cerr << std::endl;
+                return 1;
+            }
+            std::cout << "Продолжаем с тика " << dungeon.getTick() << " (" << dungeon.getNPCCount()
+                      << " NPC)" << std::endl;
+            // NPC уже есть, новых не создаем
+            dungeon.setSpawnCount(0);
+        } else if (!options.loadSnapshot.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            if (!dungeon.loadSnapshot(options.loadSnapshot)) {
+                std::cerr << "Не удалось прочитать снимок: " << options.loadSnapshot << std::endl;
+                return 1;
+            }
+            std::cout << "Загружен снимок: " << dungeon.getNPCCount() << " NPC за "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " мс" << std::endl;
+            dungeon.setSpawnCount(0);
+        }
+        if (!options.checkpoint.empty()) {
+            dungeon.enableCheckpoints(options.checkpoint, options.checkpointEvery);
+        }
+        if (!options.record.empty()) {
+            FileLogConfig recordConfig;
+            recordConfig.path = options.record;
+            recordConfig.format = FileLogConfig::Format::Binary;
+            recordConfig.bufferSize = 1 << 20;
+            recordConfig.flushIntervalMs = 1000;
+            recordConfig.truncate = true;
+            dungeon.addObserver(std::make_shared<FileObserver>(recordConfig));
+            dungeon.setRecording(true);
+        }
+        
+        if (!options.metrics.empty()) {
+            Profiler::global().startDump(options.metrics, std::chrono::milliseconds(options.metricsEvery));
+        }
+        
+        if (options.headless) {
+            int code = runHeadless(dungeon, options);
+            Profiler::global().stopDump();
+            return code;
+        }
+        
         // Добавляем Observer'ы
         auto consoleObserver = std::make_shared<ConsoleObserver>();
         auto fileObserver = std::make_shared<FileObserver>();
@@ -43,8 +392,8 @@ int main() {
         // Запускаем игру
         dungeon.startGame();
         
-        // Ждем 30 секунд
-        for (int i = 0; i < 30; ++i) {
+        // Ждем окончания игры
+        for (int i = 0; i < options.duration && dungeon.isRunning(); ++i) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
             if (!dungeon.getAliveCount()) {
                 std::cout << "\nВсе NPC погибли! Завершаем игру досрочно." << std::endl;
@@ -52,15 +401,17 @@ int main() {
             }
         }
         
-        // Останавливаем игру
+        // Останавливаем игру (и ждем завершения всех потоков)
         dungeon.stopGame();
-        
-        // Ждем немного чтобы все потоки завершились
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        // Последний дамп метрик - после остановки
+        Profiler::global().stopDump();
         
         // Сохраняем результаты
         dungeon.saveToFile("dungeon_final.txt");
         std::cout << "\nРезультаты сохранены в файлы 'dungeon_final.txt' и 'log.txt'\n";
+        if (!saveFinalSnapshot(dungeon, options)) {
+            return 1;
+        }
         
         // Финальный вывод статистики
         dungeon.printNPCs();
@@ -71,4 +422,4 @@ int main() {
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,390 @@
+#include "../include/checkpoint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+enum FrameKind : std::uint8_t { FRAME_FULL = 0, FRAME_DELTA = 1 };
+const std::uint8_t FLAG_ALIVE = 1;
+const std::uint8_t FLAG_NAME = 2;
+
+// FNV-1a: отличает кадр, оборванный на середине, от целого
+std::uint64_t frameHash(const std::string& bytes) {
+    std::uint64_t hash = 1469598103934665603ull;
+    for (unsigned char byte : bytes) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void put(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Последовательное чтение тела кадра с проверкой границ
+class Cursor {
+private:
+    const std::string& bytes;
+    size_t offset = 0;
+
+public:
+    explicit Cursor(const std::string& bytes) : bytes(bytes) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (bytes.size() - offset < sizeof(value)) return false;
+        std::memcpy(&value, bytes.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return true;
+    }
+
+    bool getString(std::string& value, size_t length) {
+        if (bytes.size() - offset < length) return false;
+        value.assign(bytes.data() + offset, length);
+        offset += length;
+        return true;
+    }
+};
+
+template <typename T>
+bool readRaw(std::istream& is, T& value) {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+std::string fileHeader() {
+    std::string header(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    put(header, CHECKPOINT_VERSION);
+    put(header, std::uint16_t(0));
+    return header;
+}
+
+// NPC в разборе файла: последнее известное состояние по id
+struct Entry {
+    bool present = false;
+    NPCType type = NPCType::Dragon;
+    value::Body body;
+};
+
+bool applyFrame(const std::string& frame, std::vector<Entry>& entries, CheckpointState& state) {
+    Cursor cursor(frame);
+    std::uint8_t kind = 0, deterministic = 0;
+    CheckpointState next = state;
+    if (!cursor.get(kind) || !cursor.get(next.tick) || !cursor.get(next.meta.seed) ||
+        !cursor.get(deterministic) || !cursor.get(next.meta.nextNPCId) || !cursor.get(next.stats.fights)) {
+        return false;
+    }
+    if (kind != FRAME_FULL && (kind != FRAME_DELTA || state.frames == 0)) return false;
+    next.meta.deterministic = deterministic != 0;
+    next.stats.kills = 0;
+    for (auto& row : next.stats.killsByPair) {
+        for (auto& kills : row) {
+            if (!cursor.get(kills)) return false;
+            next.stats.kills += kills;
+        }
+    }
+    std::uint64_t compacted = 0, deathsCurrentTick = 0;
+    std::uint32_t historySize = 0;
+    if (!cursor.get(compacted) || !cursor.get(deathsCurrentTick) || !cursor.get(historySize) ||
+        historySize > DEATH_HISTORY) {
+        return false;
+    }
+    next.stats.compacted = static_cast<size_t>(compacted);
+    next.stats.deathsCurrentTick = static_cast<size_t>(deathsCurrentTick);
+    next.stats.deathsHistorySize = historySize;
+    next.stats.deathsLastTick = 0;
+    for (std::uint32_t i = 0; i < historySize; ++i) {
+        std::uint64_t deaths = 0;
+        if (!cursor.get(deaths)) return false;
+        next.stats.deathsHistory[i] = static_cast<size_t>(deaths);
+        next.stats.deathsLastTick = next.stats.deathsHistory[i];
+    }
+
+    // Кадр применяется к копии: битый кадр не должен испортить состояние
+    std::vector<Entry> updated = kind == FRAME_FULL ? std::vector<Entry>() : entries;
+    std::uint32_t count = 0;
+    if (!cursor.get(count)) return false;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint32_t id = 0;
+        std::uint8_t type = 0, flags = 0;
+        double x = 0, y = 0;
+        if (!cursor.get(id) || !cursor.get(type) || !cursor.get(flags) || !cursor.get(x) || !cursor.get(y)) {
+            return false;
+        }
+        if (id == NPC::NO_ID || type >= NPC_TYPE_COUNT) return false;
+        // Сетка не принимает NaN и бесконечности
+        if (!std::isfinite(x) || !std::isfinite(y)) return false;
+        if (id >= updated.size()) updated.resize(static_cast<size_t>(id) + 1);
+
+        Entry& entry = updated[id];
+        if (flags & FLAG_NAME) {
+            std::uint16_t length = 0;
+            std::string name;
+            if (!cursor.get(length) || !cursor.getString(name, length)) return false;
+            entry.body.nameId = NameTable::global().intern(name);
+        } else if (!entry.present) {
+            // Новый NPC обязан прийти с именем
+            return false;
+        }
+        entry.present = true;
+        entry.type = static_cast<NPCType>(type);
+        entry.body.id = id;
+        entry.body.x = x;
+        entry.body.y = y;
+        entry.body.alive = (flags & FLAG_ALIVE) != 0;
+    }
+
+    std::uint32_t removed = 0;
+    if (!cursor.get(removed)) return false;
+    for (std::uint32_t i = 0; i < removed; ++i) {
+        std::uint32_t id = 0;
+        if (!cursor.get(id)) return false;
+        if (id < updated.size()) updated[id].present = false;
+    }
+
+    entries.swap(updated);
+    next.frames = state.frames + 1;
+    state = next;
+    return true;
+}
+
+} // namespace
+
+bool readCheckpoint(const std::string& path, CheckpointState& state) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    std::uint16_t version = 0, reserved = 0;
+    if (!file.read(magic, sizeof(magic)) || !readRaw(file, version) || !readRaw(file, reserved) ||
+        std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != CHECKPOINT_VERSION) {
+        return false;
+    }
+
+    CheckpointState result;
+    std::vector<Entry> entries;
+    std::string frame;
+    while (true) {
+        std::uint32_t length = 0;
+        std::uint64_t hash = 0;
+        if (!readRaw(file, length)) break;
+        frame.resize(length);
+        if (!file.read(&frame[0], length) || !readRaw(file, hash) || hash != frameHash(frame)) {
+            break;  // Оборванный хвост после падения
+        }
+        if (!applyFrame(frame, entries, result)) break;
+    }
+    if (result.frames == 0) return false;
+
+    // Порядок NPC - по id, как их создает подземелье
+    result.npcs.clear();
+    for (const Entry& entry : entries) {
+        if (entry.present) {
+            result.npcs.push_back(value::make(entry.type, entry.body));
+        }
+    }
+    state = std::move(result);
+    return true;
+}
+
+Checkpointer::Checkpointer(const std::string& path, size_t fullEvery)
+    : path(path), fullEvery(fullEvery > 0 ? fullEvery : 1), stopping(false), idle(true),
+      sinceFull(0), mark(0), written(0), skipped(0), failed(0), bytesWritten(0), lastTick(0) {
+    writer = std::thread(&Checkpointer::writerLoop, this);
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::submit(std::shared_ptr<const WorldSnapshot> snapshot, const CheckpointMeta& meta) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) return;
+        if (pending) skipped++;
+        pending = std::move(snapshot);
+        pendingMeta = meta;
+        idle = false;
+    }
+    cv.notify_one();
+}
+
+void Checkpointer::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCV.wait(lock, [this]() { return idle; });
+}
+
+void Checkpointer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void Checkpointer::writerLoop() {
+    while (true) {
+        std::shared_ptr<const WorldSnapshot> snapshot;
+        CheckpointMeta meta;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || pending; });
+            if (!pending) break;
+            snapshot = std::move(pending);
+            meta = pendingMeta;
+        }
+
+        // Диск - вне блокировки, submit в это время не ждет
+        writeCheckpoint(*snapshot, meta);
+        snapshot.reset();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pending) {
+            idle = true;
+            idleCV.notify_all();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    idle = true;
+    idleCV.notify_all();
+}
+
+void Checkpointer::writeCheckpoint(const WorldSnapshot& snapshot, const CheckpointMeta& meta) {
+    const bool full = sinceFull == 0 || !out.is_open();
+    mark++;
+
+    // Изменения копятся в копии и принимаются только после записи:
+    // иначе следующая разность опустила бы то, что не дошло до диска
+    std::vector<Known> next = known;
+
+    std::string records;
+    std::uint32_t recordCount = 0;
+    for (const auto& npc : snapshot.npcs) {
+        const value::Body& data = value::body(npc);
+        if (data.id == NPC::NO_ID) continue;
+        if (data.id >= next.size()) next.resize(static_cast<size_t>(data.id) + 1);
+
+        Known& entry = next[data.id];
+        const std::uint8_t type = static_cast<std::uint8_t>(value::typeOf(npc));
+        const bool changed = full || !entry.present || entry.type != type || entry.alive != data.alive ||
+                             entry.x != data.x || entry.y != data.y;
+        entry.mark = mark;
+        if (!changed) continue;
+
+        const bool withName = full || !entry.named;
+        std::uint8_t flags = (data.alive ? FLAG_ALIVE : 0) | (withName ? FLAG_NAME : 0);
+        put(records, data.id);
+        put(records, type);
+        put(records, flags);
+        put(records, data.x);
+        put(records, data.y);
+        if (withName) {
+            const std::string& name = NameTable::global().name(data.nameId);
+            std::uint16_t length = static_cast<std::uint16_t>(std::min<size_t>(name.size(), 0xFFFF));
+            put(records, length);
+            records.append(name.data(), length);
+        }
+        recordCount++;
+
+        entry.present = true;
+        entry.named = true;
+        entry.type = type;
+        entry.alive = data.alive;
+        entry.x = data.x;
+        entry.y = data.y;
+    }
+
+    // Кого не было в этом снимке, тот удален уплотнением
+    std::vector<std::uint32_t> removed;
+    for (size_t id = 0; id < next.size(); ++id) {
+        Known& entry = next[id];
+        if (entry.present && entry.mark != mark) {
+            if (!full) removed.push_back(static_cast<std::uint32_t>(id));
+            entry = Known{};
+        }
+    }
+
+    std::string body;
+    put(body, full ? FRAME_FULL : FRAME_DELTA);
+    put(body, snapshot.tick);
+    put(body, meta.seed);
+    put(body, static_cast<std::uint8_t>(meta.deterministic));
+    put(body, meta.nextNPCId);
+    put(body, snapshot.stats.fights);
+    for (const auto& row : snapshot.stats.killsByPair) {
+        for (std::uint64_t kills : row) {
+            put(body, kills);
+        }
+    }
+    put(body, static_cast<std::uint64_t>(snapshot.stats.compacted));
+    put(body, static_cast<std::uint64_t>(snapshot.stats.deathsCurrentTick));
+    put(body, static_cast<std::uint32_t>(snapshot.stats.deathsHistorySize));
+    for (size_t i = 0; i < snapshot.stats.deathsHistorySize; ++i) {
+        put(body, static_cast<std::uint64_t>(snapshot.stats.deathsHistory[i]));
+    }
+    put(body, recordCount);
+    body += records;
+    put(body, static_cast<std::uint32_t>(removed.size()));
+    for (std::uint32_t id : removed) {
+        put(body, id);
+    }
+
+    std::string frame;
+    put(frame, static_cast<std::uint32_t>(body.size()));
+    frame += body;
+    put(frame, frameHash(body));
+
+    if (!writeFrame(frame, full)) {
+        // Дописанный наполовину кадр читатель отбросит по хешу,
+        // а следующая точка перепишет файл целиком
+        out.close();
+        sinceFull = 0;
+        failed++;
+        return;
+    }
+
+    known = std::move(next);
+    sinceFull = (sinceFull + 1) % fullEvery;
+    written++;
+    bytesWritten += frame.size();
+    lastTick = snapshot.tick;
+}
+
+bool Checkpointer::writeFrame(const std::string& frame, bool full) {
+    if (!full) {
+        out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        out.flush();
+        return static_cast<bool>(out);
+    }
+
+    // Новый файл пишется рядом и подменяет старый целиком
+    out.close();
+    std::string temporary = path + ".tmp";
+    std::error_code error;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        std::string header = fileHeader();
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        file.close();
+        if (!file) {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    // Файл уже целый; если дописывать не получится, следующая точка
+    // снова будет полной (out не открыт)
+    out.open(path, std::ios::binary | std::ios::app);
+    return true;
+}
@@ -1,5 +1,11 @@
 #include "../include/dungeon.h"
 #include "../include/factory.h"
+#include "../include/npc_store.h"
+#include "../include/snapshot.h"
+#include "../include/counter_rng.h"
+#include "../include/checkpoint.h"
+#include "../include/profiler.h"
+#include "../include/replay.h"
 #include <iostream>
 #include <sstream>
 #include <chrono>
@@ -7,35 +13,177 @@
 #include <iomanip>
 #include <algorithm>
 
-Dungeon::Dungeon() : running(false), fightCount(0) {
-    npcs.reserve(100);
-}
+// Меньше этого числа NPC на участника параллелить движение невыгодно
+static const size_t MOVEMENT_MIN_CHUNK = 1024;
+// Размер порции задач боев, передаваемой пулу за раз
+static const size_t FIGHT_SUBMIT_BATCH = 4096;
+
+Dungeon::Dungeon() : storage(NPCStorage::Objects), columnsStale(true), columnsAlive(0),
+                     grid(config.width, config.height, config.getMaxKillDistance()),
+                     eventBus(std::make_shared<EventBus>()), running(false),
+                     tick(0), gameDurationSeconds(30), seeded(false), masterSeed(0),
+                     deterministic(false), nextNPCId(0), compactDeadFraction(0.5), compactMinDead(64),
+                     worldDirty(true), checkpointEvery(0), lastCheckpointTick(0),
+                     recording(false),
+                     movementThreads(std::max(1u, std::thread::hardware_concurrency())),
+                     fightThreads(std::max(1u, std::thread::hardware_concurrency() / 2)),
+                     fightQueueCapacity(65536) {}
 
 Dungeon::~Dungeon() {
     stopGame();
+    // NPC могут пережить подземелье (shared_ptr), отвязываем их от сетки и счетчиков
+    grid.clear();
+    for (const auto& npc : npcs) {
+        npc->attachStats(nullptr);
+    }
+}
+
+void Dungeon::indexNPC(NPC* npc) {
+    // Ячейка сетки не меньше максимальной дистанции убийства
+    if (npc->getKillDistance() > grid.getCellSize()) {
+        grid.resize(npc->getKillDistance());
+    }
+    grid.insert(npc);
+}
+
+void Dungeon::pushNPC(std::shared_ptr<NPC> npc) {
+    // Дистанции задает мир, а не тип по умолчанию
+    const size_t type = static_cast<size_t>(npc->getTypeTag());
+    npc->setDistances(config.moveDistance[type], config.killDistance[type]);
+    
+    std::uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(handleSlots.size());
+        handleSlots.push_back({FREE_SLOT, 0});
+    }
+    handleSlots[slot].index = static_cast<std::uint32_t>(npcs.size());
+    npcSlots.push_back(slot);
+    
+    indexNPC(npc.get());
+    stats.onAdded(npc->getTypeTag(), npc->isAlive());
+    // Дальше живые счетчики ведет сам NPC::die
+    npc->attachStats(&stats);
+    npcs.push_back(std::move(npc));
+    columnsStale = true;
+    worldDirty = true;
+}
+
+void Dungeon::clearNPCs() {
+    grid.clear();
+    for (const auto& npc : npcs) {
+        npc->attachStats(nullptr);
+    }
+    npcs.clear();
+    ghosts.clear();
+    // Все выданные ссылки становятся недействительными
+    for (std::uint32_t slot : npcSlots) {
+        handleSlots[slot].index = FREE_SLOT;
+        handleSlots[slot].generation++;
+        freeSlots.push_back(slot);
+    }
+    npcSlots.clear();
+    columns.clear();
+    columnsStale = true;
+    stats.clearPopulation();
+    nextNPCId = 0;
+    worldDirty = true;
+}
+
+void Dungeon::syncColumns() {
+    if (storage != NPCStorage::Columns) return;
+    if (columnsStale) {
+        // Состав, номера или дистанции менялись - проще собрать заново
+        columns.assign(npcs);
+        columnsAlive = columns.aliveCount();
+        columnsStale = false;
+        return;
+    }
+    if (columnsAlive == stats.getAlive()) return;
+    // Умирают только в боях, по объектам; смотрим лишь тех, кто был жив
+    const std::uint8_t* alive = columns.aliveData();
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        if (alive[i] && !npcs[i]->isAlive()) {
+            columns.setAlive(i, false);
+            columnsAlive--;
+        }
+    }
+}
+
+bool Dungeon::columnsInSync() const {
+    return storage == NPCStorage::Columns && !columnsStale && columnsAlive == stats.getAlive();
+}
+
+void Dungeon::setStorage(NPCStorage newStorage) {
+    std::unique_lock lock(npcsMutex);
+    storage = newStorage;
+    columns.clear();
+    columnsStale = true;
+}
+
+void Dungeon::assignIds() {
+    // Заданные заранее номера сохраняем, остальным выдаем следующие по порядку
+    for (const auto& npc : npcs) {
+        if (npc->getId() != NPC::NO_ID) {
+            nextNPCId = std::max(nextNPCId, npc->getId() + 1);
+        }
+    }
+    for (const auto& npc : npcs) {
+        if (npc->getId() == NPC::NO_ID) {
+            npc->setId(nextNPCId++);
+        }
+    }
+    columnsStale = true;
 }
 
 void Dungeon::addNPC(std::shared_ptr<NPC> npc) {
     std::unique_lock lock(npcsMutex);
-    if (npc->getX() >= 0 && npc->getX() <= 100 && npc->getY() >= 0 && npc->getY() <= 100) {
-        npcs.push_back(npc);
+    if (config.bounds().contains(npc->getX(), npc->getY())) {
+        if (npc->getId() == NPC::NO_ID) {
+            npc->setId(nextNPCId++);
+        } else {
+            nextNPCId = std::max(nextNPCId, npc->getId() + 1);
+        }
+        pushNPC(npc);
     }
 }
 
 void Dungeon::addObserver(std::shared_ptr<Observer> observer) {
-    observers.push_back(observer);
+    eventBus->addObserver(observer);
 }
 
-void Dungeon::printNPCs() const {
+void Dungeon::setEventOverflowPolicy(OverflowPolicy policy) {
+    eventBus->setOverflowPolicy(policy);
+}
+
+void Dungeon::setRecording(bool enabled) {
+    recording = enabled;
+    if (enabled) {
+        eventBus->setOverflowPolicy(OverflowPolicy::Block);
+    }
+}
+
+void Dungeon::recordSpawns() {
+    if (!recording) return;
     std::shared_lock lock(npcsMutex);
+    for (const auto& npc : npcs) {
+        eventBus->onSpawn(npc->ref(), npc->getTypeTag(), npc->getX(), npc->getY(), npc->isAlive());
+    }
+}
+
+void Dungeon::printNPCs() const {
+    auto snapshot = getWorld();
     std::cout << "\n=== СПИСОК ВЫЖИВШИХ NPC ===\n";
     int aliveCount = 0;
-    for (const auto& npc : npcs) {
-        if (npc->isAlive()) {
-            std::cout << "Тип: " << std::setw(8) << std::left << npc->getType() 
-                      << " Имя: " << std::setw(15) << std::left << npc->getName() 
-                      << " Координаты: (" << std::setw(3) << (int)npc->getX() 
-                      << ", " << std::setw(3) << (int)npc->getY() << ")\n";
+    for (const auto& npc : snapshot->npcs) {
+        const value::Body& data = value::body(npc);
+        if (data.alive) {
+            std::cout << "Тип: " << std::setw(8) << std::left << value::typeName(npc) 
+                      << " Имя: " << std::setw(15) << std::left << NameTable::global().name(data.nameId) 
+                      << " Координаты: (" << std::setw(3) << (int)data.x 
+                      << ", " << std::setw(3) << (int)data.y << ")\n";
             aliveCount++;
         }
     }
@@ -43,11 +191,11 @@ void Dungeon::printNPCs() const {
 }
 
 void Dungeon::saveToFile(const std::string& filename) const {
-    std::shared_lock lock(npcsMutex);
+    auto snapshot = getWorld();
     std::ofstream file(filename);
-    for (const auto& npc : npcs) {
-        if (npc->isAlive()) {
-            npc->save(file);
+    for (const auto& npc : snapshot->npcs) {
+        if (value::body(npc).alive) {
+            value::save(file, npc);
             file << "\n";
         }
     }
@@ -55,30 +203,241 @@ void Dungeon::saveToFile(const std::string& filename) const {
 
 void Dungeon::loadFromFile(const std::string& filename) {
     std::unique_lock lock(npcsMutex);
-    npcs.clear();
+    clearNPCs();
     std::ifstream file(filename);
     std::string line;
     while (std::getline(file, line)) {
         std::istringstream iss(line);
         auto npc = NPCFactory::loadFromStream(iss);
         if (npc) {
-            npcs.push_back(npc);
+            pushNPC(npc);
         }
     }
+    assignIds();
 }
 
-size_t Dungeon::getNPCCount() const {
+bool Dungeon::saveSnapshot(const std::string& filename) const {
     std::shared_lock lock(npcsMutex);
-    return npcs.size();
+    // Хранилище подземелья уже в формате файла
+    if (columnsInSync()) {
+        return ::saveSnapshot(columns, filename);
+    }
+    NPCStore store;
+    store.assign(npcs);
+    lock.unlock();
+    return ::saveSnapshot(store, filename);
+}
+
+bool Dungeon::loadSnapshot(const std::string& filename) {
+    // Файл отображается прямо в массивы хранилища, без блокировки подземелья
+    NPCStore loaded;
+    if (!::loadSnapshot(filename, loaded)) {
+        return false;
+    }
+    // Объекты для боев и сетки - пачкой в арене, с готовыми номерами имен
+    auto created = loaded.toNPCs(&arena);
+    
+    std::unique_lock lock(npcsMutex);
+    clearNPCs();
+    npcs.reserve(created.size());
+    for (auto& npc : created) {
+        pushNPC(std::move(npc));
+    }
+    assignIds();
+    if (storage == NPCStorage::Columns) {
+        // Загруженные массивы и становятся хранилищем подземелья: остается
+        // взять номера NPC и дистанции мира
+        for (size_t i = 0; i < npcs.size(); ++i) {
+            const size_t type = static_cast<size_t>(npcs[i]->getTypeTag());
+            loaded.setId(i, npcs[i]->getId());
+            loaded.setDistances(i, config.moveDistance[type], config.killDistance[type]);
+        }
+        columns = std::move(loaded);
+        columnsAlive = columns.aliveCount();
+        columnsStale = false;
+    }
+    return true;
+}
+
+size_t Dungeon::getNPCCount() const {
+    return stats.getTotal();
 }
 
 size_t Dungeon::getAliveCount() const {
+    return stats.getAlive();
+}
+
+StatsSnapshot Dungeon::getStats() const {
+    StatsSnapshot result = stats.snapshot();
+    result.tick = tick;
+    return result;
+}
+
+void Dungeon::publishWorld() const {
+    PROFILE_SCOPE(Snapshot);
+    world.publish([this](WorldSnapshot& snapshot) {
+        snapshot.tick = tick;
+        snapshot.npcs.clear();
+        snapshot.npcs.reserve(npcs.size());
+        if (columnsInSync()) {
+            // Подряд по массивам, без обращения к объектам
+            const NPCType* types = columns.typeData();
+            const std::uint32_t* ids = columns.idData();
+            const std::uint32_t* nameIds = columns.nameIdData();
+            const double* xs = columns.xData();
+            const double* ys = columns.yData();
+            const std::uint8_t* alive = columns.aliveData();
+            for (size_t i = 0; i < columns.size(); ++i) {
+                value::Body data;
+                data.id = ids[i];
+                data.nameId = nameIds[i];
+                data.x = xs[i];
+                data.y = ys[i];
+                data.alive = alive[i] != 0;
+                snapshot.npcs.push_back(value::make(types[i], data));
+            }
+        } else {
+            for (const auto& npc : npcs) {
+                snapshot.npcs.push_back(value::fromNPC(*npc));
+            }
+        }
+        snapshot.stats = getStats();
+    });
+    worldDirty = false;
+}
+
+void Dungeon::enableCheckpoints(const std::string& path, std::uint64_t everyTicks, size_t fullEvery) {
+    checkpointer = std::make_unique<Checkpointer>(path, fullEvery);
+    checkpointEvery = std::max<std::uint64_t>(1, everyTicks);
+}
+
+void Dungeon::submitCheckpoint(bool publish) {
+    if (!checkpointer || lastCheckpointTick == tick) return;
+    if (publish) publishWorld();
+    lastCheckpointTick = tick;
+    checkpointer->submit(world.acquire(), CheckpointMeta{masterSeed, deterministic, nextNPCId});
+}
+
+// Догоняет мир точки по журналу: применяет записи, начиная с Tick(tick + 1).
+// Счетчики боев, убийств, уплотнения и смертей по тикам идут вместе с миром
+static bool rollForward(const std::string& logPath, CheckpointState& state) {
+    EventLogReader reader;
+    if (!reader.open(logPath)) return false;
+
+    ReplayState replay;
+    replay.tick = state.tick;
+    for (const auto& npc : state.npcs) {
+        const std::uint32_t id = value::body(npc).id;
+        if (id >= replay.npcs.size()) {
+            replay.npcs.resize(static_cast<size_t>(id) + 1);
+            replay.present.resize(replay.npcs.size(), 0);
+        }
+        replay.npcs[id] = npc;
+        replay.present[id] = 1;
+    }
+    auto aliveAt = [&replay](std::uint32_t id) {
+        return id < replay.present.size() && replay.present[id] && value::body(replay.npcs[id]).alive;
+    };
+
+    StatsSnapshot& stats = state.stats;
+    bool started = false;
+    LogRecord record;
+    while (reader.next(record)) {
+        if (!started) {
+            if (record.type != LogRecord::Type::Tick || record.tick <= state.tick) continue;
+            // Запись начата позже точки: пропущенные тики не восстановить
+            if (record.tick != state.tick + 1) return false;
+            started = true;
+        }
+        switch (record.type) {
+            case LogRecord::Type::Tick:
+                // Как DungeonStats::onTick: закрываем тик в кольце смертей
+                if (stats.deathsHistorySize < DEATH_HISTORY) {
+                    stats.deathsHistory[stats.deathsHistorySize++] = stats.deathsCurrentTick;
+                } else {
+                    std::move(stats.deathsHistory.begin() + 1, stats.deathsHistory.end(), stats.deathsHistory.begin());
+                    stats.deathsHistory.back() = stats.deathsCurrentTick;
+                }
+                stats.deathsLastTick = stats.deathsCurrentTick;
+                stats.deathsCurrentTick = 0;
+                replay.apply(record, reader);
+                break;
+            case LogRecord::Type::Fight:
+            case LogRecord::Type::Die: {
+                const std::uint32_t victim = record.type == LogRecord::Type::Fight ? record.target : record.npc;
+                const bool wasAlive = aliveAt(victim);
+                replay.apply(record, reader);
+                if (wasAlive && !aliveAt(victim)) stats.deathsCurrentTick++;
+                break;
+            }
+            case LogRecord::Type::Remove:
+                if (record.npc < replay.present.size() && replay.present[record.npc]) stats.compacted++;
+                replay.apply(record, reader);
+                break;
+            default:
+                replay.apply(record, reader);
+                break;
+        }
+    }
+    // Журнал кончился до точки: точка новее, догонять нечего
+    if (!started) return true;
+
+    state.tick = replay.tick;
+    stats.fights += replay.fights;
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        for (size_t j = 0; j < NPC_TYPE_COUNT; ++j) {
+            stats.killsByPair[i][j] += replay.killsByPair[i][j];
+            stats.kills += replay.killsByPair[i][j];
+        }
+    }
+    state.meta.nextNPCId = std::max(state.meta.nextNPCId, static_cast<std::uint32_t>(replay.npcs.size()));
+    state.npcs = replay.world();
+    return true;
+}
+
+bool Dungeon::resumeFromCheckpoint(const std::string& path, const std::string& logPath) {
+    CheckpointState state;
+    if (!readCheckpoint(path, state)) {
+        return false;
+    }
+    if (!logPath.empty() && !rollForward(logPath, state)) {
+        return false;
+    }
+    auto loaded = value::toNPCs(state.npcs);
+    
+    std::unique_lock lock(npcsMutex);
+    clearNPCs();
+    npcs.reserve(loaded.size());
+    for (auto& npc : loaded) {
+        pushNPC(std::move(npc));
+    }
+    stats.restoreCounters(state.stats);
+    nextNPCId = state.meta.nextNPCId;
+    tick = state.tick;
+    lastCheckpointTick = state.tick;
+    masterSeed = state.meta.seed;
+    seeded = true;
+    deterministic = state.meta.deterministic;
+    return true;
+}
+
+std::shared_ptr<const WorldSnapshot> Dungeon::getWorld() const {
+    // Пока игра идет, снимок публикует тик движения (читать NPC посреди
+    // хода нельзя). Остановленное подземелье после изменений публикуем сами
+    if (worldDirty && !running) {
+        std::shared_lock lock(npcsMutex);
+        publishWorld();
+    }
+    return world.acquire();
+}
+
+std::uint64_t Dungeon::stateChecksum() const {
     std::shared_lock lock(npcsMutex);
-    size_t count = 0;
+    std::uint64_t hash = npcs.size();
     for (const auto& npc : npcs) {
-        if (npc->isAlive()) count++;
+        hash = mixNPCState(hash, npc->getId(), npc->getX(), npc->getY(), npc->isAlive());
     }
-    return count;
+    return hash;
 }
 
 const std::vector<std::shared_ptr<NPC>>& Dungeon::getNPCs() const {
@@ -86,143 +445,293 @@ const std::vector<std::shared_ptr<NPC>>& Dungeon::getNPCs() const {
 }
 
 void Dungeon::processFight(FightTask& task) {
+    // Бои идут в нескольких потоках, поэтому генератор у каждого свой
+    thread_local std::mt19937 gen(std::random_device{}());
+    resolveFight(task, gen);
+}
+
+void Dungeon::resolveFight(FightTask& task, std::mt19937& gen) {
+    resolveFightWith(task, gen);
+}
+
+void Dungeon::resolveFight(FightTask& task, CounterRng& rng) {
+    resolveFightWith(task, rng);
+}
+
+template <typename Generator>
+void Dungeon::resolveFightWith(FightTask& task, Generator& gen) {
     auto attacker = task.attacker;
     auto defender = task.defender;
     
     if (!attacker || !defender || !attacker->isAlive() || !defender->isAlive()) {
         return;
     }
+    // Меряем только состоявшиеся бои, а не отсеянные задачи
+    PROFILE_SCOPE(FightResolve);
     
     // Проверяем, может ли атакующий атаковать защитника
     if (attacker->canAttack(defender.get())) {
-        std::mt19937 gen(rd());
-        
         int attackPower = attacker->rollAttack(gen);
         int defensePower = defender->rollDefense(gen);
         
-        // Отладочный вывод для проверки правил
+#ifdef VERBOSE_OUTPUT
+        // Отладочный вывод для проверки правил (синхронный, только для отладки)
         std::cout << "[АТАКА] " << attacker->getName() << " (" << attacker->getType() 
                   << ") атакует " << defender->getName() << " (" << defender->getType() 
                   << "): атака=" << attackPower << ", защита=" << defensePower << std::endl;
+#endif
         
         if (attackPower > defensePower) {
             // Убийство
-            defender->die();
-            
-            // Уведомляем наблюдателей
-            for (auto& observer : observers) {
-                observer->onFight(attacker->getName(), defender->getName(), true);
-                observer->onDie(defender->getName());
+            if (defender->die()) {
+                stats.onKill(attacker->getTypeTag(), defender->getTypeTag());
             }
+            
+            // Уведомляем наблюдателей через шину (без ожидания вывода)
+            eventBus->onFight(attacker->ref(), defender->ref(), true);
+            eventBus->onDie(defender->ref());
         } else {
             // Защита успешна
-            for (auto& observer : observers) {
-                observer->onFight(attacker->getName(), defender->getName(), false);
-            }
+            eventBus->onFight(attacker->ref(), defender->ref(), false);
         }
         
-        fightCount++;
+        stats.onFight();
     }
 }
 
-void Dungeon::movementWorker() {
-    std::mt19937 gen(rd());
+std::vector<size_t> Dungeon::collectAlive() const {
+    std::vector<size_t> aliveIndices;
+    if (storage == NPCStorage::Columns) {
+        const std::uint8_t* alive = columns.aliveData();
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (alive[i]) aliveIndices.push_back(i);
+        }
+        return aliveIndices;
+    }
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        if (npcs[i]->isAlive()) {
+            aliveIndices.push_back(i);
+        }
+    }
+    return aliveIndices;
+}
+
+void Dungeon::movementTick() {
+    PROFILE_SCOPE(Tick);
+    // Живые NPC на начало тика
+    syncColumns();
+    std::vector<size_t> aliveIndices = collectAlive();
+    beginTick(aliveIndices.size());
+    moveAlive(aliveIndices);
+    if (deterministic) {
+        resolveFightsInOrder(aliveIndices);
+    } else {
+        submitFights(aliveIndices);
+    }
+}
+
+void Dungeon::beginTick(size_t aliveCount) {
+    tick++;
+    stats.onTick();
+    if (recording) {
+        eventBus->onTick(tick);
+    }
+    PROFILE_GAUGE(AliveNPCs, aliveCount);
+}
+
+void Dungeon::moveAlive(const std::vector<size_t>& aliveIndices) {
+    // Правило записи, исключающее гонки по x/y:
+    //  1. участник меняет координаты только своих NPC и не читает чужие;
+    //  2. сетку обновляет один поток, пока остальные стоят;
+    //  3. при поиске боев координаты только читаются.
+    // В воспроизводимом режиме шаг NPC берет числа из генератора с ключом
+    // (зерно, тик, id) и не зависит от разбиения на участки.
+    const size_t count = aliveIndices.size();
+    const WorldBounds bounds = config.bounds();
+    const std::uint64_t currentTick = tick;
     
-    while (running) {
-        // Делаем паузу между движениями
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        
-        {
-            std::shared_lock lock(npcsMutex);
-            if (npcs.empty() || !running) continue;
-            
-            // Создаем копию индексов живых NPC
-            std::vector<size_t> aliveIndices;
-            for (size_t i = 0; i < npcs.size(); ++i) {
-                if (npcs[i]->isAlive()) {
-                    aliveIndices.push_back(i);
-                }
-            }
-            
-            // Перемешиваем индексы для случайного порядка движения
-            std::shuffle(aliveIndices.begin(), aliveIndices.end(), gen);
-            
-            for (size_t idx : aliveIndices) {
-                if (!running) break;
-                
-                // Двигаем NPC
-                npcs[idx]->move(gen);
-                
-                // Проверяем возможность боя с другими NPC
-                // Проверяем только часть NPC чтобы не перегружать
-                for (size_t j = 0; j < std::min(npcs.size(), (size_t)10); ++j) {
-                    if (idx == j || !npcs[j]->isAlive()) continue;
-                    
-                    double distance = npcs[idx]->distanceTo(*npcs[j]);
-                    if (distance <= npcs[idx]->getKillDistance()) {
-                        // Создаем задачу для потока боев
-                        std::lock_guard<std::mutex> fightLock(fightQueueMutex);
-                        fightQueue.push({npcs[idx], npcs[j]});
-                        fightCV.notify_one();
+    std::vector<std::uint8_t> moved(count);
+    {
+        PROFILE_SCOPE(Move);
+        movementPool->parallelFor(count, MOVEMENT_MIN_CHUNK, [&](size_t begin, size_t end, size_t worker) {
+            if (storage == NPCStorage::Columns) {
+                // Те же числа и правила, что у NPC::step, но по массивам
+                const std::uint32_t* ids = columns.idData();
+                if (deterministic) {
+                    for (size_t i = begin; i < end; ++i) {
+                        CounterRng rng(masterSeed, CounterRng::STREAM_MOVE, currentTick, ids[aliveIndices[i]]);
+                        moved[i] = columns.step(aliveIndices[i], rng, bounds);
                     }
+                } else {
+                    std::mt19937& gen = workerGens[worker];
+                    for (size_t i = begin; i < end; ++i) {
+                        moved[i] = columns.step(aliveIndices[i], gen, bounds);
+                    }
+                }
+            } else if (deterministic) {
+                for (size_t i = begin; i < end; ++i) {
+                    NPC& npc = *npcs[aliveIndices[i]];
+                    CounterRng rng(masterSeed, CounterRng::STREAM_MOVE, currentTick, npc.getId());
+                    moved[i] = npc.step(rng, bounds);
+                }
+            } else {
+                std::mt19937& gen = workerGens[worker];
+                for (size_t i = begin; i < end; ++i) {
+                    moved[i] = npcs[aliveIndices[i]]->step(gen, bounds);
                 }
             }
+        });
+    }
+    
+    reindexMoved(aliveIndices, moved);
+}
+
+void Dungeon::reindexMoved(const std::vector<size_t>& aliveIndices, const std::vector<std::uint8_t>& moved) {
+    PROFILE_SCOPE(Reindex);
+    const bool fromColumns = storage == NPCStorage::Columns;
+    for (size_t i = 0; i < moved.size(); ++i) {
+        if (!moved[i]) continue;
+        const size_t index = aliveIndices[i];
+        NPC& npc = *npcs[index];
+        if (fromColumns) {
+            // Сетка и бои читают координаты из объекта
+            npc.place(columns.xData()[index], columns.yData()[index]);
         }
+        npc.reindex();
+        if (recording) eventBus->onMove(npc.ref(), npc.getX(), npc.getY());
+    }
+}
+
+template <typename Fn>
+void Dungeon::forEachEncounter(const std::vector<size_t>& aliveIndices, size_t begin, size_t end, Fn&& fn) const {
+    // Атакующие - живые свои NPC, за ними призраки соседних регионов.
+    // Защитники только свои: в сетке лежат они, призраков там нет
+    const size_t count = aliveIndices.size();
+    for (size_t i = begin; i < end && running; ++i) {
+        const auto& npc = i < count ? npcs[aliveIndices[i]] : ghosts[i - count];
+        // Жаб и других безобидных типов даже не проверяем
+        if (!canTypeAttackAny(npc->getTypeTag())) continue;
+        grid.forEachInRange(npc->getX(), npc->getY(), npc->getKillDistance(), [&](NPC* other) {
+            if (other == npc.get() || !other->isAlive() || !npc->canAttack(other)) return;
+            fn(FightTask{npc, other->shared_from_this()});
+        });
     }
 }
 
-void Dungeon::fightWorker() {
+void Dungeon::submitFights(const std::vector<size_t>& aliveIndices) {
+    // Ищем всех NPC в радиусе атаки через сетку
+    PROFILE_SCOPE(Encounter);
+    const size_t attackers = aliveIndices.size() + ghosts.size();
+    movementPool->parallelFor(attackers, MOVEMENT_MIN_CHUNK, [&](size_t begin, size_t end, size_t) {
+        std::vector<FightTask> found;
+        forEachEncounter(aliveIndices, begin, end, [&](FightTask&& task) {
+            found.push_back(std::move(task));
+            // Отдаем порциями, чтобы в плотном мире память не росла без границ
+            if (found.size() >= FIGHT_SUBMIT_BATCH) {
+                PROFILE_SCOPE(FightSubmit);
+                fightPool->submit(found);
+                found.clear();
+            }
+        });
+        
+        // Отдаем задачи пулу боев одной порцией (может ждать места в очереди)
+        PROFILE_SCOPE(FightSubmit);
+        fightPool->submit(found);
+    });
+    
+    // Сколько работы тик оставил пулу боев и диспетчеру событий
+    PROFILE_GAUGE(FightQueueDepth, fightPool->depth());
+    PROFILE_GAUGE(EventQueueDepth, eventBus->getPending());
+}
+
+void Dungeon::resolveFightsInOrder(const std::vector<size_t>& aliveIndices) {
+    // Найденные бои сортируются и решаются по порядку в этом потоке,
+    // поэтому результат не зависит от числа участников поиска
+    const size_t attackers = aliveIndices.size() + ghosts.size();
+    std::vector<std::vector<FightTask>> found(movementPool->size());
+    {
+        PROFILE_SCOPE(Encounter);
+        movementPool->parallelFor(attackers, MOVEMENT_MIN_CHUNK, [&](size_t begin, size_t end, size_t worker) {
+            forEachEncounter(aliveIndices, begin, end, [&](FightTask&& task) {
+                found[worker].push_back(std::move(task));
+            });
+        });
+    }
+    
+    std::vector<FightTask> fights;
+    for (auto& part : found) {
+        fights.insert(fights.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    std::sort(fights.begin(), fights.end(), [](const FightTask& a, const FightTask& b) {
+        if (a.attacker->getId() != b.attacker->getId()) return a.attacker->getId() < b.attacker->getId();
+        return a.defender->getId() < b.defender->getId();
+    });
+    
+    // Броски боя - из генератора с ключом (зерно, тик, атакующий, защитник):
+    // числа не зависят ни от порядка, ни от стандартной библиотеки.
+    // Порядок по-прежнему решает, чей бой первым убьет защитника
+    for (auto& task : fights) {
+        CounterRng rng(masterSeed, CounterRng::STREAM_FIGHT, tick, task.attacker->getId(),
+                       task.defender->getId());
+        resolveFight(task, rng);
+    }
+    PROFILE_GAUGE(EventQueueDepth, eventBus->getPending());
+}
+
+Task Dungeon::movementLoop() {
     while (running) {
-        FightTask task;
-        bool hasTask = false;
+        // Пауза между движениями - таймер планировщика, поток пула свободен
+        co_await scheduler->sleepFor(std::chrono::milliseconds(200));
         
         {
-            std::unique_lock<std::mutex> lock(fightQueueMutex);
-            
-            // Ждем задачи или остановки с таймаутом
-            if (fightCV.wait_for(lock, std::chrono::milliseconds(100), 
-                [this]() { return !fightQueue.empty() || !running; })) {
-                
-                if (!running) break;
-                
-                if (!fightQueue.empty()) {
-                    task = fightQueue.front();
-                    fightQueue.pop();
-                    hasTask = true;
-                }
+            std::shared_lock lock(npcsMutex);
+            if (npcs.empty() || !running) continue;
+            movementTick();
+        }
+        // Снимок и точка - только после боев тика: иначе в них остались бы
+        // живыми NPC, которых убивают прямо сейчас
+        {
+            PROFILE_SCOPE(FightDrain);
+            fightPool->waitIdle();
+        }
+        {
+            std::shared_lock lock(npcsMutex);
+            syncColumns();
+            publishWorld();
+            if (checkpointer && tick % checkpointEvery == 0) {
+                submitCheckpoint(false);
             }
         }
         
-        if (hasTask) {
-            processFight(task);
+        if (shouldCompact()) {
+            compact();
         }
     }
 }
 
 void Dungeon::printMap() {
-    const int MAP_SIZE = 100;
-    const int CELL_SIZE = 10;
+    // Разрешение карты не зависит от размеров мира: клетка - доля мира
+    const int columns = config.mapColumns;
+    const int rows = config.mapRows;
+    const double cellWidth = config.width / columns;
+    const double cellHeight = config.height / rows;
     
-    std::vector<std::vector<std::string>> map(MAP_SIZE/CELL_SIZE, 
-                                             std::vector<std::string>(MAP_SIZE/CELL_SIZE, "."));
+    std::vector<std::vector<std::string>> map(rows, std::vector<std::string>(columns, "."));
     
-    int dragonCount = 0, bullCount = 0, toadCount = 0;
+    // Карта и счетчики из одного снимка, подземелье не блокируется
+    auto snapshot = getWorld();
+    const StatsSnapshot& current = snapshot->stats;
     
-    {
-        std::shared_lock lock(npcsMutex);
-        
-        for (const auto& npc : npcs) {
-            if (npc->isAlive()) {
-                int x = static_cast<int>(npc->getX()) / CELL_SIZE;
-                int y = static_cast<int>(npc->getY()) / CELL_SIZE;
-                
-                if (x >= 0 && x < MAP_SIZE/CELL_SIZE && y >= 0 && y < MAP_SIZE/CELL_SIZE) {
-                    map[y][x] = npc->getTypeSymbol();
-                    
-                    if (npc->getType() == "Dragon") dragonCount++;
-                    else if (npc->getType() == "Bull") bullCount++;
-                    else if (npc->getType() == "Toad") toadCount++;
-                }
+    for (const auto& npc : snapshot->npcs) {
+        const value::Body& data = value::body(npc);
+        if (data.alive) {
+            // Правая и нижняя границы мира попадают в крайнюю клетку
+            int x = std::min(columns - 1, static_cast<int>(data.x / cellWidth));
+            int y = std::min(rows - 1, static_cast<int>(data.y / cellHeight));
+            
+            if (x >= 0 && y >= 0) {
+                // Символ по тегу типа, без временных строк
+                map[y][x] = value::typeSymbol(npc);
             }
         }
     }
@@ -233,46 +742,329 @@ void Dungeon::printMap() {
     
     std::cout << "\n=== КАРТА ПОДЗЕМЕЛЬЯ ===" << std::endl;
     std::cout << "Легенда: D - Дракон, B - Бык, T - Жаба, . - пусто" << std::endl;
-    std::cout << "Драконы: " << dragonCount << ", Быки: " << bullCount << ", Жабы: " << toadCount << std::endl;
+    std::cout << "Драконы: " << current.aliveByType[static_cast<size_t>(NPCType::Dragon)]
+              << ", Быки: " << current.aliveByType[static_cast<size_t>(NPCType::Bull)]
+              << ", Жабы: " << current.aliveByType[static_cast<size_t>(NPCType::Toad)] << std::endl;
     
-    for (int y = 0; y < MAP_SIZE/CELL_SIZE; ++y) {
-        for (int x = 0; x < MAP_SIZE/CELL_SIZE; ++x) {
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
             std::cout << std::setw(2) << map[y][x];
         }
         std::cout << std::endl;
     }
     
-    std::cout << "Всего живых: " << getAliveCount() 
-              << " из " << getNPCCount()
-              << ", Боев проведено: " << fightCount.load() << std::endl;
+    std::cout << "Всего живых: " << current.alive 
+              << " из " << current.total
+              << ", Боев проведено: " << current.fights << std::endl;
 }
 
-void Dungeon::mainWorker() {
-    auto startTime = std::chrono::steady_clock::now();
-    int lastMapTime = -2; // Чтобы первая карта отобразилась сразу
+Task Dungeon::mapLoop() {
+    using Clock = Scheduler::Clock;
+    const auto endTime = Clock::now() + std::chrono::seconds(gameDurationSeconds);
+    // Первая карта - сразу, дальше раз в 3 секунды
+    auto nextMap = Clock::now();
     
     while (running) {
-        auto currentTime = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime);
-        
-        if (elapsed.count() >= 30) {
-            stopGame();
-            break;
+        auto now = Clock::now();
+        if (now >= endTime) {
+            std::cout << "\n=== ИГРА ОКОНЧЕНА (прошло " << gameDurationSeconds << " секунд) ===" << std::endl;
+            // Планировщик остановит владелец подземелья (stopGame)
+            requestStop();
+            co_return;
         }
         
-        // Печатаем карту раз в 3 секунды
-        if (elapsed.count() / 3 != lastMapTime) {
-            lastMapTime = elapsed.count() / 3;
+        if (now >= nextMap) {
+            nextMap += std::chrono::seconds(3);
+            PROFILE_SCOPE(MapRender);
             printMap();
         }
         
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Спим ровно до ближайшего события, а не опрашиваем каждые 100 мс
+        co_await scheduler->sleepUntil(std::min(nextMap, endTime));
     }
+}
+
+unsigned Dungeon::nextSeed() {
+    return seeded ? static_cast<unsigned>(seedSource()) : rd();
+}
+
+void Dungeon::setSeed(unsigned seed) {
+    seeded = true;
+    masterSeed = seed;
+    seedSource.seed(seed);
+    NPCFactory::setSeed(seed);
+}
+
+void Dungeon::setWorldConfig(const WorldConfig& newConfig) {
+    std::unique_lock lock(npcsMutex);
+    config = newConfig;
+    // Сетка по новым размерам; ячейка - по наибольшей дистанции убийства
+    grid.reshape(config.width, config.height, config.getMaxKillDistance());
+    for (const auto& npc : npcs) {
+        const size_t type = static_cast<size_t>(npc->getTypeTag());
+        npc->setDistances(config.moveDistance[type], config.killDistance[type]);
+    }
+    columnsStale = true;
+    worldDirty = true;
+}
+
+void Dungeon::spawnRandomNPCs(size_t count) {
+    // Объекты создаются одной пачкой в арене, в подземелье - под одной блокировкой
+    auto created = NPCFactory::createMany(count, config.spawnRegion(), &arena, config.typeWeights());
     
-    // Финальный вывод
-    if (running) {
-        std::cout << "\n=== ИГРА ОКОНЧЕНА (прошло 30 секунд) ===" << std::endl;
-        printNPCs();
+    std::unique_lock lock(npcsMutex);
+    npcs.reserve(npcs.size() + created.size());
+    for (auto& npc : created) {
+        npc->setId(nextNPCId++);
+        pushNPC(std::move(npc));
+    }
+}
+
+void Dungeon::reset() {
+    stopGame();
+    // Вместе с пулами уходят и задачи боев, держащие NPC
+    fightPool.reset();
+    movementPool.reset();
+    
+    std::unique_lock lock(npcsMutex);
+    clearNPCs();
+    npcs.shrink_to_fit();
+    npcSlots.shrink_to_fit();
+    stats.reset();
+    tick = 0;
+    // Если снаружи еще держат NPC (getNPCs, handleAt), блоки арены
+    // остаются в пуле и достанутся следующим NPC
+    arena.release();
+}
+
+void Dungeon::setCompaction(double deadFraction, size_t minDead) {
+    compactDeadFraction = std::max(0.0, deadFraction);
+    compactMinDead = minDead;
+}
+
+bool Dungeon::shouldCompact() const {
+    if (compactDeadFraction <= 0) return false;
+    size_t total = stats.getTotal();
+    size_t dead = total - stats.getAlive();
+    return dead > 0 && dead >= compactMinDead && dead >= compactDeadFraction * total;
+}
+
+CompactionReport Dungeon::compact() {
+    std::unique_lock lock(npcsMutex);
+    return compactLocked();
+}
+
+CompactionReport Dungeon::compactLocked() {
+    PROFILE_SCOPE(Compaction);
+    auto startTime = std::chrono::steady_clock::now();
+    size_t arenaBefore = arena.getBytesLive();
+    size_t arrayBefore = npcs.capacity() * sizeof(npcs[0]) + npcSlots.capacity() * sizeof(npcSlots[0]);
+    
+    CompactionReport report;
+    report.removed = removeLocked([](const NPC& npc) { return !npc.isAlive(); }, nullptr);
+    const size_t kept = npcs.size();
+    stats.onRemoved(report.removed);
+    
+    size_t arenaAfter = arena.getBytesLive();
+    size_t arrayAfter = npcs.capacity() * sizeof(npcs[0]) + npcSlots.capacity() * sizeof(npcSlots[0]);
+    report.remaining = kept;
+    report.bytesReclaimed = (arenaBefore - std::min(arenaBefore, arenaAfter)) +
+                            (arrayBefore - std::min(arrayBefore, arrayAfter));
+    report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    lastCompaction = report;
+    return report;
+}
+
+size_t Dungeon::removeLocked(const std::function<bool(const NPC&)>& remove,
+                             std::vector<std::shared_ptr<NPC>>* taken) {
+    // Сдвигаем оставшихся к началу в прежнем порядке, слоты убранных освобождаем
+    size_t kept = 0;
+    for (size_t i = 0; i < npcs.size(); ++i) {
+        std::uint32_t slot = npcSlots[i];
+        if (!remove(*npcs[i])) {
+            if (kept != i) {
+                npcs[kept] = std::move(npcs[i]);
+                npcSlots[kept] = slot;
+            }
+            handleSlots[slot].index = static_cast<std::uint32_t>(kept);
+            kept++;
+        } else {
+            grid.remove(npcs[i].get());
+            npcs[i]->attachStats(nullptr);
+            // Без этого повтор журнала (replay.h) считал бы убранных живущими
+            if (recording) eventBus->onRemove(npcs[i]->ref());
+            if (taken) {
+                taken->push_back(std::move(npcs[i]));
+            }
+            npcs[i].reset();
+            handleSlots[slot].index = FREE_SLOT;
+            handleSlots[slot].generation++;
+            freeSlots.push_back(slot);
+        }
+    }
+    
+    const size_t removed = npcs.size() - kept;
+    npcs.resize(kept);
+    npcSlots.resize(kept);
+    // Массивы ужимаем, только если они стали заметно больше нужного
+    if (npcs.capacity() > 2 * kept) {
+        npcs.shrink_to_fit();
+        npcSlots.shrink_to_fit();
+    }
+    if (removed > 0) columnsStale = true;
+    worldDirty = true;
+    return removed;
+}
+
+void Dungeon::startStepping() {
+    if (running) return;
+    running = true;
+    startWorkers();
+}
+
+void Dungeon::stepMovement() {
+    std::shared_lock lock(npcsMutex);
+    syncColumns();
+    std::vector<size_t> aliveIndices = collectAlive();
+    beginTick(aliveIndices.size());
+    moveAlive(aliveIndices);
+}
+
+void Dungeon::stepFights() {
+    {
+        std::shared_lock lock(npcsMutex);
+        // Между шагами состав мог измениться, живых собираем заново
+        syncColumns();
+        std::vector<size_t> aliveIndices = collectAlive();
+        if (deterministic) {
+            resolveFightsInOrder(aliveIndices);
+        } else {
+            submitFights(aliveIndices);
+        }
+    }
+    {
+        PROFILE_SCOPE(FightDrain);
+        fightPool->waitIdle();
+    }
+    worldDirty = true;
+    if (shouldCompact()) {
+        compact();
+    }
+}
+
+void Dungeon::stepGhostFights() {
+    // Призраков меняет только владелец цикла, тот же поток
+    if (ghosts.empty()) return;
+    {
+        std::shared_lock lock(npcsMutex);
+        // Атакуют только призраки: свои NPC уже отбились в stepFights
+        const std::vector<size_t> noOwnAttackers;
+        if (deterministic) {
+            resolveFightsInOrder(noOwnAttackers);
+        } else {
+            submitFights(noOwnAttackers);
+        }
+    }
+    {
+        PROFILE_SCOPE(FightDrain);
+        fightPool->waitIdle();
+    }
+    {
+        // Копии годны только на этот тик
+        std::unique_lock lock(npcsMutex);
+        ghosts.clear();
+    }
+    worldDirty = true;
+}
+
+std::vector<value::NPCValue> Dungeon::takeNPCsIf(const std::function<bool(const NPC&)>& pred) {
+    std::vector<std::shared_ptr<NPC>> taken;
+    {
+        std::unique_lock lock(npcsMutex);
+        removeLocked(pred, &taken);
+        for (const auto& npc : taken) {
+            stats.onDeparted(npc->getTypeTag(), npc->isAlive());
+        }
+    }
+    std::vector<value::NPCValue> result;
+    result.reserve(taken.size());
+    for (const auto& npc : taken) {
+        result.push_back(value::fromNPC(*npc));
+    }
+    return result;
+}
+
+std::vector<value::NPCValue> Dungeon::copyNPCsIf(const std::function<bool(const NPC&)>& pred) const {
+    std::shared_lock lock(npcsMutex);
+    std::vector<value::NPCValue> result;
+    for (const auto& npc : npcs) {
+        if (pred(*npc)) {
+            result.push_back(value::fromNPC(*npc));
+        }
+    }
+    return result;
+}
+
+void Dungeon::addNPCs(const std::vector<value::NPCValue>& values) {
+    std::unique_lock lock(npcsMutex);
+    npcs.reserve(npcs.size() + values.size());
+    for (const auto& npc : values) {
+        auto created = value::toNPC(npc);
+        nextNPCId = std::max(nextNPCId, created->getId() + 1);
+        pushNPC(std::move(created));
+    }
+}
+
+void Dungeon::setGhosts(const std::vector<value::NPCValue>& values) {
+    std::unique_lock lock(npcsMutex);
+    ghosts.clear();
+    ghosts.reserve(values.size());
+    for (const auto& npc : values) {
+        auto ghost = value::toNPC(npc);
+        // Правила мира те же, что у своих (см. pushNPC)
+        const size_t type = static_cast<size_t>(ghost->getTypeTag());
+        ghost->setDistances(config.moveDistance[type], config.killDistance[type]);
+        ghosts.push_back(std::move(ghost));
+    }
+}
+
+NPCHandle Dungeon::handleAt(size_t index) const {
+    std::shared_lock lock(npcsMutex);
+    if (index >= npcSlots.size()) return NPCHandle{};
+    std::uint32_t slot = npcSlots[index];
+    return NPCHandle{slot, handleSlots[slot].generation};
+}
+
+std::shared_ptr<NPC> Dungeon::resolve(NPCHandle handle) const {
+    std::shared_lock lock(npcsMutex);
+    if (handle.slot >= handleSlots.size()) return nullptr;
+    const HandleSlot& slot = handleSlots[handle.slot];
+    if (slot.generation != handle.generation || slot.index == FREE_SLOT) return nullptr;
+    return npcs[slot.index];
+}
+
+void Dungeon::startWorkers() {
+    // Пул для фазы движения: у каждого участника независимый поток чисел
+    movementPool = std::make_unique<ThreadPool>(movementThreads);
+    workerGens.clear();
+    for (size_t i = 0; i < movementPool->size(); ++i) {
+        std::seed_seq seq{nextSeed(), nextSeed(), static_cast<unsigned>(i)};
+        workerGens.emplace_back(seq);
+    }
+    
+    // Диспетчер событий запускается раньше потоков, которые их порождают
+    eventBus->start();
+    
+    // Пул боев: задачи шардируются по защитнику, свободные потоки крадут работу
+    fightPool = std::make_unique<FightPool>(fightThreads, fightQueueCapacity,
+                                            [this](FightTask& task) { processFight(task); });
+    fightPool->start();
+}
+
+void Dungeon::stopWorkers() {
+    // Останавливаем пул боев: это же будит движение, ждущее места в очереди
+    if (fightPool) {
+        fightPool->stop();
     }
 }
 
@@ -281,53 +1073,116 @@ void Dungeon::startGame() {
     
     running = true;
     
-    // Создаем 50 NPC в случайных местах
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> posDist(0, 100);
-    
+    // Создаем NPC в случайных местах
     std::cout << "Создаю NPC..." << std::endl;
-    for (int i = 0; i < 50; ++i) {
-        double x = posDist(gen);
-        double y = posDist(gen);
-        auto npc = NPCFactory::createRandomNPC(x, y);
-        if (npc) {
-            addNPC(npc);
+    spawnRandomNPCs(config.spawnCount);
+    
+    std::cout << "Создано " << getNPCCount() << " NPC. Начинаем игру!" << std::endl;
+    std::cout << "Игра продлится " << gameDurationSeconds << " секунд..." << std::endl;
+    
+    startWorkers();
+    {
+        // Первая карта появляется раньше первого тика
+        std::shared_lock lock(npcsMutex);
+        publishWorld();
+    }
+    recordSpawns();
+    
+    // Тик движения и карта - две задачи на двух потоках планировщика:
+    // долгий тик не задерживает карту
+    scheduler = std::make_unique<Scheduler>(2);
+    scheduler->spawn(movementLoop());
+    scheduler->spawn(mapLoop());
+}
+
+HeadlessReport Dungeon::runHeadless(std::uint64_t ticks) {
+    HeadlessReport report;
+    if (running) return report;
+    
+    running = true;
+    startWorkers();
+    recordSpawns();
+    
+    auto startTime = std::chrono::steady_clock::now();
+    std::uint64_t done = 0;
+    for (; done < ticks && running; ++done) {
+        {
+            std::shared_lock lock(npcsMutex);
+            movementTick();
+        }
+        // Бои этого тика должны закончиться до следующего движения
+        {
+            PROFILE_SCOPE(FightDrain);
+            fightPool->waitIdle();
+        }
+        // Без отрисовки снимок нужен редко: публикует его первый читатель
+        worldDirty = true;
+        if (checkpointer && tick % checkpointEvery == 0) {
+            // Копия мира делается здесь, запись на диск - в потоке точек
+            std::shared_lock lock(npcsMutex);
+            syncColumns();
+            submitCheckpoint(true);
+        }
+        if (shouldCompact()) {
+            CompactionReport compaction = compact();
+            report.compactions++;
+            report.compactionMilliseconds += compaction.milliseconds;
         }
     }
+    auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime);
     
-    std::cout << "Создано " << getNPCCount() << " NPC. Начинаем игру!" << std::endl;
-    std::cout << "Игра продлится 30 секунд..." << std::endl;
+    stopGame();
     
-    // Запускаем потоки
-    movementThread = std::thread(&Dungeon::movementWorker, this);
-    fightThread = std::thread(&Dungeon::fightWorker, this);
-    mainThread = std::thread(&Dungeon::mainWorker, this);
+    report.ticks = done;
+    report.wallSeconds = wall.count();
+    report.ticksPerSecond = wall.count() > 0 ? done / wall.count() : 0;
+    report.fights = static_cast<int>(stats.getFights());
+    report.alive = getAliveCount();
+    report.total = getNPCCount();
+    report.removed = stats.snapshot().compacted;
+    report.checksum = stateChecksum();
+    report.bytesPerNPC = getBytesPerNPC();
+    return report;
+}
+
+void Dungeon::setMovementThreads(size_t threads) {
+    movementThreads = std::max<size_t>(1, threads);
+}
+
+void Dungeon::setFightThreads(size_t threads, size_t queueCapacity) {
+    fightThreads = std::max<size_t>(1, threads);
+    fightQueueCapacity = std::max<size_t>(1, queueCapacity);
+}
+
+void Dungeon::requestStop() {
+    running = false;
 }
 
 void Dungeon::stopGame() {
-    if (!running) return;
-    
+    std::lock_guard<std::mutex> stopLock(stopMutex);
     running = false;
     
-    // Оповещаем все потоки
-    fightCV.notify_all();
+    stopWorkers();
     
-    // Ждем завершения потоков с таймаутом
-    if (movementThread.joinable()) {
-        if (movementThread.get_id() != std::this_thread::get_id()) {
-            movementThread.join();
-        }
+    // Ждем текущий шаг задач; спящие задачи уничтожаются сразу, без
+    // досыпания паузы
+    if (scheduler) {
+        scheduler->stop();
+        scheduler.reset();
     }
+    // Последний снимок мог быть опубликован до боев, решенных при остановке:
+    // первый читатель опубликует мир заново
+    worldDirty = true;
     
-    if (fightThread.joinable()) {
-        if (fightThread.get_id() != std::this_thread::get_id()) {
-            fightThread.join();
-        }
-    }
+    // Доставляем оставшиеся события наблюдателям
+    eventBus->stop();
     
-    if (mainThread.joinable()) {
-        if (mainThread.get_id() != std::this_thread::get_id()) {
-            mainThread.join();
+    // Последняя точка - на момент остановки
+    if (checkpointer) {
+        {
+            std::shared_lock lock(npcsMutex);
+            submitCheckpoint(true);
         }
+        checkpointer->flush();
     }
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "../include/dungeon_stats.h"
+#include <algorithm>
+
+DungeonStats::DungeonStats() {
+    reset();
+}
+
+void DungeonStats::onAdded(NPCType type, bool isAlive) {
+    total.fetch_add(1, std::memory_order_relaxed);
+    if (isAlive) {
+        alive[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DungeonStats::onDeparted(NPCType type, bool isAlive) {
+    total.fetch_sub(1, std::memory_order_relaxed);
+    if (isAlive) {
+        alive[static_cast<size_t>(type)].fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void DungeonStats::onKill(NPCType attacker, NPCType defender) {
+    kills[static_cast<size_t>(attacker)][static_cast<size_t>(defender)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void DungeonStats::onDeath(NPCType type) {
+    alive[static_cast<size_t>(type)].fetch_sub(1, std::memory_order_relaxed);
+    deathsCurrentTick.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DungeonStats::onTick() {
+    const std::uint64_t closed = ticksClosed.load(std::memory_order_relaxed);
+    deathsHistory[closed % DEATH_HISTORY].store(deathsCurrentTick.exchange(0, std::memory_order_relaxed),
+                                                std::memory_order_relaxed);
+    ticksClosed.store(closed + 1, std::memory_order_release);
+}
+
+void DungeonStats::onRemoved(size_t count) {
+    total.fetch_sub(count, std::memory_order_relaxed);
+    compacted.fetch_add(count, std::memory_order_relaxed);
+}
+
+void DungeonStats::restoreCounters(const StatsSnapshot& saved) {
+    fights.store(saved.fights, std::memory_order_relaxed);
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        for (size_t j = 0; j < NPC_TYPE_COUNT; ++j) {
+            kills[i][j].store(saved.killsByPair[i][j], std::memory_order_relaxed);
+        }
+    }
+    deathsCurrentTick.store(saved.deathsCurrentTick, std::memory_order_relaxed);
+    const size_t size = std::min(saved.deathsHistorySize, DEATH_HISTORY);
+    for (size_t i = 0; i < size; ++i) {
+        deathsHistory[i].store(saved.deathsHistory[i], std::memory_order_relaxed);
+    }
+    ticksClosed.store(size, std::memory_order_release);
+    compacted.store(saved.compacted, std::memory_order_relaxed);
+}
+
+void DungeonStats::clearPopulation() {
+    total.store(0, std::memory_order_relaxed);
+    for (auto& counter : alive) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    compacted.store(0, std::memory_order_relaxed);
+}
+
+void DungeonStats::reset() {
+    clearPopulation();
+    fights.store(0, std::memory_order_relaxed);
+    for (auto& row : kills) {
+        for (auto& counter : row) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+    deathsCurrentTick.store(0, std::memory_order_relaxed);
+    for (auto& counter : deathsHistory) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    ticksClosed.store(0, std::memory_order_relaxed);
+}
+
+size_t DungeonStats::getAlive() const {
+    size_t sum = 0;
+    for (const auto& counter : alive) {
+        sum += counter.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+StatsSnapshot DungeonStats::snapshot() const {
+    StatsSnapshot result;
+    result.total = getTotal();
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        result.aliveByType[i] = alive[i].load(std::memory_order_relaxed);
+        result.alive += result.aliveByType[i];
+        for (size_t j = 0; j < NPC_TYPE_COUNT; ++j) {
+            result.killsByPair[i][j] = kills[i][j].load(std::memory_order_relaxed);
+            result.kills += result.killsByPair[i][j];
+        }
+    }
+    result.fights = getFights();
+    result.deathsCurrentTick = deathsCurrentTick.load(std::memory_order_relaxed);
+    const std::uint64_t closed = ticksClosed.load(std::memory_order_acquire);
+    result.deathsHistorySize = static_cast<size_t>(std::min<std::uint64_t>(closed, DEATH_HISTORY));
+    for (size_t i = 0; i < result.deathsHistorySize; ++i) {
+        const std::uint64_t tickIndex = closed - result.deathsHistorySize + i;
+        result.deathsHistory[i] = deathsHistory[tickIndex % DEATH_HISTORY].load(std::memory_order_relaxed);
+    }
+    if (result.deathsHistorySize > 0) {
+        result.deathsLastTick = result.deathsHistory[result.deathsHistorySize - 1];
+    }
+    result.compacted = compacted.load(std::memory_order_relaxed);
+    return result;
+}
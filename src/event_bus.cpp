@@ -0,0 +1,255 @@
+#include "../include/event_bus.h"
+#include "../include/profiler.h"
+
+EventBus::EventBus(size_t capacity, OverflowPolicy policy, size_t batchSize)
+    : ring(capacity), policy(policy), batchSize(batchSize > 0 ? batchSize : 1), running(false),
+      dispatcherSleeping(false), waitingProducers(0), inFlight(0), overflowing(false),
+      published(0), dropped(0), coalesced(0) {}
+
+EventBus::~EventBus() {
+    stop();
+}
+
+void EventBus::addObserver(std::shared_ptr<Observer> observer) {
+    observers.push_back(observer);
+}
+
+void EventBus::start() {
+    if (running) return;
+    running = true;
+    dispatcher = std::thread(&EventBus::dispatchLoop, this);
+}
+
+void EventBus::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        running = false;
+    }
+    eventCV.notify_all();
+    spaceCV.notify_all();
+
+    // Диспетчер перед выходом доставляет все, что уже в кольце
+    if (dispatcher.joinable()) {
+        dispatcher.join();
+    }
+    idleCV.notify_all();
+}
+
+void EventBus::wakeDispatcher() {
+    // Барьер в паре с барьером в ожидании диспетчера: либо мы увидим,
+    // что он спит, либо он увидит наше событие
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (dispatcherSleeping) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        eventCV.notify_one();
+    }
+}
+
+void EventBus::publish(Event&& event) {
+    published++;
+    inFlight++;
+
+    if (!overflowing.load(std::memory_order_acquire) && ring.tryPush(std::move(event))) {
+        wakeDispatcher();
+        return;
+    }
+
+    // Кольцо заполнено или ждет доставки слитых перемещений
+    if (policy == OverflowPolicy::Drop) {
+        inFlight--;
+        dropped++;
+        return;
+    }
+
+    if (policy == OverflowPolicy::Coalesce && event.type == Event::Type::Move) {
+        {
+            std::lock_guard<std::mutex> lock(coalesceMutex);
+            // Ключ - номер NPC вместе с номером имени (у NPC вне подземелья номера нет)
+            std::uint64_t key = (static_cast<std::uint64_t>(event.npc.id) << 32) | event.npc.nameId;
+            auto result = overflowIndex.try_emplace(key, overflow.size());
+            if (!result.second) {
+                // Старое перемещение этого NPC вычеркнуто; новое встает в конец,
+                // после всех событий, которые пришли между ними
+                superseded[result.first->second] = 1;
+                result.first->second = overflow.size();
+                inFlight--;
+                coalesced++;
+            }
+            overflow.push_back(event);
+            superseded.push_back(0);
+            overflowing.store(true, std::memory_order_release);
+        }
+        wakeDispatcher();
+        return;
+    }
+
+    // Block (а при Coalesce - бои и смерти): ждем места
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitingProducers++;
+            spaceCV.wait(lock, [this]() {
+                return !running || (!overflowing && ring.sizeApprox() < ring.capacity());
+            });
+            waitingProducers--;
+            if (!running) break;
+        }
+        if (!overflowing && ring.tryPush(std::move(event))) {
+            wakeDispatcher();
+            return;
+        }
+    }
+
+    inFlight--;
+    dropped++;
+}
+
+size_t EventBus::drainBatch(std::vector<Event>& batch) {
+    batch.resize(batchSize);
+    size_t count = 0;
+    while (count < batchSize && ring.tryPop(batch[count])) {
+        count++;
+    }
+    return count;
+}
+
+void EventBus::deliver(const Event& event) {
+    for (auto& observer : observers) {
+        switch (event.type) {
+            case Event::Type::Fight:
+                observer->onFight(event.npc, event.target, event.defenderDied);
+                break;
+            case Event::Type::Move:
+                observer->onMove(event.npc, event.x, event.y);
+                break;
+            case Event::Type::Die:
+                observer->onDie(event.npc);
+                break;
+            case Event::Type::Spawn:
+                observer->onSpawn(event.npc, event.npcType, event.x, event.y, event.alive);
+                break;
+            case Event::Type::Tick:
+                observer->onTick(event.tick);
+                break;
+            case Event::Type::Remove:
+                observer->onRemove(event.npc);
+                break;
+        }
+    }
+}
+
+void EventBus::dispatchLoop() {
+    std::vector<Event> batch;
+    std::vector<Event> moves;
+    std::vector<std::uint8_t> movesSuperseded;
+
+    while (true) {
+        size_t count = drainBatch(batch);
+        // Слитые перемещения забираем, только когда кольцо вычерпано:
+        // все, что в нем было, пришло раньше них
+        if (count < batchSize && overflowing.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(coalesceMutex);
+            moves.swap(overflow);
+            movesSuperseded.swap(superseded);
+            overflowIndex.clear();
+            overflowing.store(false, std::memory_order_release);
+        }
+
+        if (count == 0 && moves.empty()) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            if (!running) break;
+            dispatcherSleeping = true;
+            eventCV.wait(lock, [this]() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return !running || ring.sizeApprox() > 0 || overflowing;
+            });
+            dispatcherSleeping = false;
+            continue;
+        }
+
+        // Место в кольце уже освободилось - отпускаем производителей до вывода
+        if (waitingProducers > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            spaceCV.notify_all();
+        }
+
+        PROFILE_SCOPE(Dispatch);
+        for (size_t i = 0; i < count; ++i) {
+            deliver(batch[i]);
+        }
+        // Слитые перемещения идут после пачки из кольца, в своем порядке
+        size_t movesDelivered = 0;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            if (movesSuperseded[i]) continue;
+            deliver(moves[i]);
+            movesDelivered++;
+        }
+        // Один сброс буферов на пачку вместо сброса на каждое событие
+        for (auto& observer : observers) {
+            observer->flush();
+        }
+
+        size_t delivered = count + movesDelivered;
+        moves.clear();
+        movesSuperseded.clear();
+        if (inFlight.fetch_sub(delivered) == delivered) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            idleCV.notify_all();
+        }
+    }
+}
+
+void EventBus::onFight(NPCRef attacker, NPCRef defender, bool defenderDied) {
+    Event event;
+    event.type = Event::Type::Fight;
+    event.npc = attacker;
+    event.target = defender;
+    event.defenderDied = defenderDied;
+    publish(std::move(event));
+}
+
+void EventBus::onMove(NPCRef npc, double x, double y) {
+    Event event;
+    event.type = Event::Type::Move;
+    event.npc = npc;
+    event.x = x;
+    event.y = y;
+    publish(std::move(event));
+}
+
+void EventBus::onDie(NPCRef npc) {
+    Event event;
+    event.type = Event::Type::Die;
+    event.npc = npc;
+    publish(std::move(event));
+}
+
+void EventBus::onSpawn(NPCRef npc, NPCType type, double x, double y, bool alive) {
+    Event event;
+    event.type = Event::Type::Spawn;
+    event.npc = npc;
+    event.npcType = type;
+    event.x = x;
+    event.y = y;
+    event.alive = alive;
+    publish(std::move(event));
+}
+
+void EventBus::onTick(std::uint64_t tick) {
+    Event event;
+    event.type = Event::Type::Tick;
+    event.tick = tick;
+    publish(std::move(event));
+}
+
+void EventBus::onRemove(NPCRef npc) {
+    Event event;
+    event.type = Event::Type::Remove;
+    event.npc = npc;
+    publish(std::move(event));
+}
+
+void EventBus::flush() {
+    std::unique_lock<std::mutex> lock(waitMutex);
+    idleCV.wait(lock, [this]() { return inFlight == 0 || !running; });
+}
@@ -0,0 +1,180 @@
+#include "../include/event_log.h"
+#include "../include/npc.h"
+#include <cstring>
+
+void writeFightText(std::ostream& os, const std::string& attacker, const std::string& defender, bool defenderDied) {
+    os << "[БОЙ] " << attacker << " атакует " << defender;
+    if (defenderDied) {
+        os << " и убивает!";
+    } else {
+        os << ", но " << defender << " выживает!";
+    }
+    os << '\n';
+}
+
+void writeMoveText(std::ostream& os, const std::string& npcName, double x, double y) {
+    os << "[ДВИЖЕНИЕ] " << npcName << " переместился в (" << x << ", " << y << ")\n";
+}
+
+void writeDieText(std::ostream& os, const std::string& npcName) {
+    os << "[СМЕРТЬ] " << npcName << " погиб!\n";
+}
+
+void writeSpawnText(std::ostream& os, const std::string& npcName, const char* typeName, double x, double y) {
+    os << "[ПОЯВЛЕНИЕ] " << npcName << " (" << typeName << ") в (" << x << ", " << y << ")\n";
+}
+
+void writeTickText(std::ostream& os, std::uint64_t tick) {
+    os << "[ТИК] " << tick << '\n';
+}
+
+void writeRemoveText(std::ostream& os, const std::string& npcName) {
+    os << "[УДАЛЕНИЕ] " << npcName << " убран из мира\n";
+}
+
+template <typename T>
+static void writeRaw(std::ostream& os, const T& value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool readRaw(std::istream& is, T& value) {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void writeLogHeader(std::ostream& os) {
+    os.write(EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+    writeRaw(os, EVENT_LOG_VERSION);
+    writeRaw(os, std::uint16_t(0));
+}
+
+void writeLogRecord(std::ostream& os, const LogRecord& record) {
+    writeRaw(os, static_cast<std::uint8_t>(record.type));
+    switch (record.type) {
+        case LogRecord::Type::Name:
+            writeRaw(os, record.npc);
+            writeRaw(os, static_cast<std::uint16_t>(record.name.size()));
+            os.write(record.name.data(), static_cast<std::streamsize>(record.name.size()));
+            break;
+        case LogRecord::Type::Fight:
+            writeRaw(os, record.npc);
+            writeRaw(os, record.target);
+            writeRaw(os, static_cast<std::uint8_t>(record.defenderDied));
+            break;
+        case LogRecord::Type::Move:
+            writeRaw(os, record.npc);
+            writeRaw(os, record.x);
+            writeRaw(os, record.y);
+            break;
+        case LogRecord::Type::Die:
+        case LogRecord::Type::Remove:
+            writeRaw(os, record.npc);
+            break;
+        case LogRecord::Type::Spawn:
+            writeRaw(os, record.npc);
+            writeRaw(os, record.npcType);
+            writeRaw(os, static_cast<std::uint8_t>(record.alive));
+            writeRaw(os, record.x);
+            writeRaw(os, record.y);
+            break;
+        case LogRecord::Type::Tick:
+            writeRaw(os, record.tick);
+            break;
+    }
+}
+
+bool EventLogReader::open(const std::string& path) {
+    file.open(path, std::ios::binary);
+    names.clear();
+    if (!file) return false;
+
+    char magic[sizeof(EVENT_LOG_MAGIC)];
+    std::uint16_t version = 0, reserved = 0;
+    if (!file.read(magic, sizeof(magic)) || !readRaw(file, version) || !readRaw(file, reserved)) {
+        return false;
+    }
+    // Версия 1 - то же без Spawn и Tick, версия 2 - без Remove
+    return std::memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) == 0 && version >= 1 && version <= EVENT_LOG_VERSION;
+}
+
+bool EventLogReader::next(LogRecord& record) {
+    std::uint8_t type = 0;
+    if (!readRaw(file, type)) return false;
+
+    record.type = static_cast<LogRecord::Type>(type);
+    switch (record.type) {
+        case LogRecord::Type::Name: {
+            std::uint16_t length = 0;
+            if (!readRaw(file, record.npc) || !readRaw(file, length)) return false;
+            record.name.resize(length);
+            if (!file.read(&record.name[0], length)) return false;
+            names[record.npc] = record.name;
+            return true;
+        }
+        case LogRecord::Type::Fight: {
+            std::uint8_t died = 0;
+            if (!readRaw(file, record.npc) || !readRaw(file, record.target) || !readRaw(file, died)) return false;
+            record.defenderDied = died != 0;
+            return true;
+        }
+        case LogRecord::Type::Move:
+            return readRaw(file, record.npc) && readRaw(file, record.x) && readRaw(file, record.y);
+        case LogRecord::Type::Die:
+        case LogRecord::Type::Remove:
+            return readRaw(file, record.npc);
+        case LogRecord::Type::Spawn: {
+            std::uint8_t alive = 0;
+            if (!readRaw(file, record.npc) || !readRaw(file, record.npcType) || !readRaw(file, alive) ||
+                !readRaw(file, record.x) || !readRaw(file, record.y)) {
+                return false;
+            }
+            record.alive = alive != 0;
+            return record.npcType < NPC_TYPE_COUNT;
+        }
+        case LogRecord::Type::Tick:
+            return readRaw(file, record.tick);
+    }
+    // Неизвестный тип записи - журнал поврежден
+    return false;
+}
+
+std::uint64_t EventLogReader::tell() {
+    return static_cast<std::uint64_t>(file.tellg());
+}
+
+void EventLogReader::seek(std::uint64_t offset) {
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(offset));
+}
+
+const std::string& EventLogReader::nameOf(std::uint32_t id) const {
+    static const std::string unknown = "?";
+    auto it = names.find(id);
+    return it != names.end() ? it->second : unknown;
+}
+
+void EventLogReader::writeText(std::ostream& os, const LogRecord& record) const {
+    switch (record.type) {
+        case LogRecord::Type::Name:
+            break;
+        case LogRecord::Type::Fight:
+            writeFightText(os, nameOf(record.npc), nameOf(record.target), record.defenderDied);
+            break;
+        case LogRecord::Type::Move:
+            writeMoveText(os, nameOf(record.npc), record.x, record.y);
+            break;
+        case LogRecord::Type::Die:
+            writeDieText(os, nameOf(record.npc));
+            break;
+        case LogRecord::Type::Spawn:
+            writeSpawnText(os, nameOf(record.npc), npcTypeInfo(static_cast<NPCType>(record.npcType)).name,
+                           record.x, record.y);
+            break;
+        case LogRecord::Type::Tick:
+            writeTickText(os, record.tick);
+            break;
+        case LogRecord::Type::Remove:
+            writeRemoveText(os, nameOf(record.npc));
+            break;
+    }
+}
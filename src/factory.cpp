@@ -1,22 +1,53 @@
 #include "../include/factory.h"
 #include "../include/npc.h"
+#include "../include/npc_arena.h"
+#include <algorithm>
 #include <random>
 #include <string>
 #include <vector>
 
 using namespace std;
 
-// Генерирует случайное имя для NPC
-string NPCFactory::generateRandomName() {
-    static const vector<string> prefixes = {"Синдзи", "Сюнсуй", "Кенпачи", "Бьякуя", "Тоширо"};
-    static const vector<string> suffixes = {"Хирако", "Кьераку", "Зараки", "Кучики", "Хицугая"};
-    
+// Общий генератор фабрики
+static mt19937& factoryGenerator() {
     static random_device rd;
     static mt19937 gen(rd());
-    uniform_int_distribution<> prefixDist(0, static_cast<int>(prefixes.size()) - 1);
-    uniform_int_distribution<> suffixDist(0, static_cast<int>(suffixes.size()) - 1);
-    
-    return prefixes[prefixDist(gen)] + "_" + suffixes[suffixDist(gen)];
+    return gen;
+}
+
+void NPCFactory::setSeed(unsigned seed) {
+    factoryGenerator().seed(seed);
+}
+
+// Номера всех имен вида "префикс_суффикс" в общей таблице имен
+static const vector<uint32_t>& nameIds() {
+    static const vector<uint32_t> ids = [] {
+        const vector<string> prefixes = {"Синдзи", "Сюнсуй", "Кенпачи", "Бьякуя", "Тоширо"};
+        const vector<string> suffixes = {"Хирако", "Кьераку", "Зараки", "Кучики", "Хицугая"};
+        vector<uint32_t> result;
+        for (const auto& prefix : prefixes) {
+            for (const auto& suffix : suffixes) {
+                result.push_back(NameTable::global().intern(prefix + "_" + suffix));
+            }
+        }
+        return result;
+    }();
+    return ids;
+}
+
+static const int NAME_PARTS = 5;
+
+uint32_t NPCFactory::pickRandomNameId() {
+    mt19937& gen = factoryGenerator();
+    uniform_int_distribution<> partDist(0, NAME_PARTS - 1);
+    int prefix = partDist(gen);
+    int suffix = partDist(gen);
+    return nameIds()[prefix * NAME_PARTS + suffix];
+}
+
+// Генерирует случайное имя для NPC
+string NPCFactory::generateRandomName() {
+    return NameTable::global().name(pickRandomNameId());
 }
 
 // Создает NPC указанного типа
@@ -35,13 +66,25 @@ shared_ptr<NPC> NPCFactory::createNPC(const string& type, double x, double y, co
     return shared_ptr<NPC>();
 }
 
+// Создает NPC по тегу типа
+shared_ptr<NPC> NPCFactory::createNPC(NPCType type, double x, double y, const string& name) {
+    switch (type) {
+        case NPCType::Dragon:
+            return make_shared<Dragon>(x, y, name);
+        case NPCType::Bull:
+            return make_shared<Bull>(x, y, name);
+        case NPCType::Toad:
+            return make_shared<Toad>(x, y, name);
+    }
+    return shared_ptr<NPC>();
+}
+
 // Создает случайного NPC в указанных координатах
 shared_ptr<NPC> NPCFactory::createRandomNPC(double x, double y) {
-    static random_device rd;
-    static mt19937 gen(rd());
+    mt19937& gen = factoryGenerator();
     uniform_int_distribution<> typeDist(0, 2);
     
-    string name = generateRandomName();
+    InternedName name{pickRandomNameId()};
     
     switch (typeDist(gen)) {
         case 0:
@@ -55,12 +98,54 @@ shared_ptr<NPC> NPCFactory::createRandomNPC(double x, double y) {
     }
 }
 
+vector<shared_ptr<NPC>> NPCFactory::createMany(size_t count, const SpawnRegion& region, NPCArena* arena,
+                                              const vector<double>& typeWeights) {
+    mt19937& gen = factoryGenerator();
+    // Равные доли берутся прежним распределением: с тем же зерном
+    // получаются те же NPC, что и без настроек
+    bool uniform = typeWeights.empty() ||
+                   std::all_of(typeWeights.begin(), typeWeights.end(),
+                               [&](double weight) { return weight == typeWeights.front(); });
+    uniform_int_distribution<> typeDist(0, 2);
+    discrete_distribution<> mixDist(typeWeights.begin(), typeWeights.end());
+    uniform_real_distribution<> xDist(region.minX, region.maxX);
+    uniform_real_distribution<> yDist(region.minY, region.maxY);
+    
+    vector<shared_ptr<NPC>> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        double x = xDist(gen);
+        double y = yDist(gen);
+        InternedName name{pickRandomNameId()};
+        
+        switch (uniform ? typeDist(gen) : mixDist(gen)) {
+            case 0:
+                result.push_back(arena ? arena->make<Dragon>(x, y, name) : make_shared<Dragon>(x, y, name));
+                break;
+            case 1:
+                result.push_back(arena ? arena->make<Bull>(x, y, name) : make_shared<Bull>(x, y, name));
+                break;
+            default:
+                result.push_back(arena ? arena->make<Toad>(x, y, name) : make_shared<Toad>(x, y, name));
+                break;
+        }
+    }
+    return result;
+}
+
 // Загружает NPC из потока
 shared_ptr<NPC> NPCFactory::loadFromStream(istream& is) {
     string type, name;
     double x, y;
+    uint32_t id = NPC::NO_ID;
+    
+    // Необязательный номер NPC: "Dragon #12 10 20 Имя"
+    if ((is >> type) && (is >> ws).peek() == '#') {
+        is.get();
+        is >> id;
+    }
     
-    if (is >> type >> x >> y) {
+    if (is >> x >> y) {
         // Читаем остаток строки как имя
         getline(is, name);
         
@@ -72,7 +157,9 @@ shared_ptr<NPC> NPCFactory::loadFromStream(istream& is) {
             name = "Unnamed_" + generateRandomName();
         }
         
-        return createNPC(type, x, y, name);
+        auto npc = createNPC(type, x, y, name);
+        if (npc) npc->setId(id);
+        return npc;
     }
     
     return shared_ptr<NPC>();
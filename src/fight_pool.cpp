@@ -0,0 +1,179 @@
+#include "../include/fight_pool.h"
+#include <algorithm>
+#include <functional>
+
+FightPool::FightPool(size_t workers, size_t capacity, Handler handler)
+    : handler(std::move(handler)), capacity(0), queued(0), busyWorkers(0), sleepingWorkers(0),
+      waitingProducers(0), waitingIdle(0), running(false) {
+    size_t count = std::max<size_t>(1, workers);
+    size_t perShard = std::max<size_t>(1, capacity / count);
+    for (size_t i = 0; i < count; ++i) {
+        shards.push_back(std::make_unique<Shard>(perShard));
+        this->capacity += shards.back()->capacity();
+    }
+}
+
+FightPool::~FightPool() {
+    stop();
+}
+
+size_t FightPool::shardFor(const NPC* npc) const {
+    return std::hash<const NPC*>()(npc) % shards.size();
+}
+
+std::mutex& FightPool::lockFor(const NPC* npc) {
+    return npcLocks[std::hash<const NPC*>()(npc) % LOCK_STRIPES];
+}
+
+void FightPool::start() {
+    if (running) return;
+    running = true;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        threads.emplace_back(&FightPool::workerLoop, this, i);
+    }
+}
+
+void FightPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        running = false;
+    }
+    workCV.notify_all();
+    spaceCV.notify_all();
+    idleCV.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+
+    FightTask task;
+    for (auto& shard : shards) {
+        while (shard->tryPop(task)) {}
+    }
+    queued = 0;
+}
+
+size_t FightPool::pushFrom(size_t home, FightTask* tasks, size_t count) {
+    size_t pushed = 0;
+    for (size_t i = 0; i < shards.size() && pushed < count; ++i) {
+        pushed += shards[(home + i) % shards.size()]->pushBatch(tasks + pushed, count - pushed);
+    }
+    return pushed;
+}
+
+void FightPool::submit(std::vector<FightTask>& batch) {
+    // Раскладываем пачку по кольцам защитников, чтобы каждое получило
+    // свою часть одним pushBatch
+    const size_t count = shards.size();
+    std::vector<size_t> next(count + 1, 0);
+    for (const FightTask& task : batch) {
+        next[shardFor(task.defender.get()) + 1]++;
+    }
+    for (size_t s = 0; s < count; ++s) {
+        next[s + 1] += next[s];
+    }
+    std::vector<size_t> end(next.begin() + 1, next.end());
+    std::vector<FightTask> grouped(batch.size());
+    {
+        std::vector<size_t> cursor(next.begin(), next.end() - 1);
+        for (FightTask& task : batch) {
+            grouped[cursor[shardFor(task.defender.get())]++] = std::move(task);
+        }
+    }
+
+    size_t left = batch.size();
+    while (left > 0 && running) {
+        size_t pushed = 0;
+        for (size_t s = 0; s < count; ++s) {
+            size_t added = pushFrom(s, grouped.data() + next[s], end[s] - next[s]);
+            next[s] += added;
+            pushed += added;
+        }
+        left -= pushed;
+
+        if (pushed > 0) {
+            // Счетчик растет только на реально положенное, а потоки
+            // будятся один раз на всю положенную часть пачки
+            queued += static_cast<std::ptrdiff_t>(pushed);
+            if (sleepingWorkers > 0) {
+                std::lock_guard<std::mutex> lock(waitMutex);
+                workCV.notify_all();
+            }
+        }
+
+        if (left > 0) {
+            // Обратное давление: все кольца полны, ждем, пока бои их разгребут
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitingProducers++;
+            spaceCV.wait(lock, [this]() {
+                return !running || queued < static_cast<std::ptrdiff_t>(capacity);
+            });
+            waitingProducers--;
+        }
+    }
+}
+
+bool FightPool::tryTake(size_t worker, FightTask& task) {
+    // Сначала свое кольцо, затем крадем у соседей
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (shards[(worker + i) % shards.size()]->tryPop(task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FightPool::resolve(FightTask& task) {
+    std::mutex& first = lockFor(task.attacker.get());
+    std::mutex& second = lockFor(task.defender.get());
+
+    if (&first == &second) {
+        std::lock_guard<std::mutex> lock(first);
+        handler(task);
+    } else {
+        std::scoped_lock lock(first, second);
+        handler(task);
+    }
+}
+
+void FightPool::workerLoop(size_t worker) {
+    while (running) {
+        FightTask task;
+        // Поток считается занятым еще до того, как забрал задачу,
+        // иначе waitIdle мог бы увидеть пустые очереди и ни одного боя
+        busyWorkers++;
+        if (tryTake(worker, task)) {
+            queued--;
+            if (waitingProducers > 0) {
+                std::lock_guard<std::mutex> lock(waitMutex);
+                spaceCV.notify_all();
+            }
+            resolve(task);
+            releaseWorker();
+            continue;
+        }
+        releaseWorker();
+
+        std::unique_lock<std::mutex> lock(waitMutex);
+        sleepingWorkers++;
+        workCV.wait(lock, [this]() { return !running || queued > 0; });
+        sleepingWorkers--;
+    }
+}
+
+void FightPool::releaseWorker() {
+    // Ожидающий отмечается под мьютексом до проверки условия, поэтому
+    // либо он увидит ноль занятых, либо мы увидим его и разбудим
+    if (--busyWorkers == 0 && waitingIdle > 0) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        idleCV.notify_all();
+    }
+}
+
+void FightPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waitingIdle++;
+    idleCV.wait(lock, [this]() { return !running || (queued <= 0 && busyWorkers == 0); });
+    waitingIdle--;
+}
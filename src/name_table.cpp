@@ -0,0 +1,54 @@
+#include "../include/name_table.h"
+#include <stdexcept>
+
+NameTable::NameTable() : count(0) {
+    for (auto& chunk : chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+NameTable::~NameTable() {
+    for (auto& chunk : chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+NameTable& NameTable::global() {
+    static NameTable table;
+    return table;
+}
+
+std::uint32_t NameTable::intern(std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lookup.find(name);
+    if (it != lookup.end()) {
+        return it->second;
+    }
+
+    std::uint32_t id = count.load(std::memory_order_relaxed);
+    size_t chunkIndex = id >> CHUNK_BITS;
+    if (chunkIndex >= MAX_CHUNKS) {
+        throw std::length_error("таблица имен переполнена");
+    }
+    std::string* chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::string[CHUNK_SIZE];
+        chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    std::string& slot = chunk[id & (CHUNK_SIZE - 1)];
+    slot.assign(name.data(), name.size());
+    lookup.emplace(std::string_view(slot), id);
+    // Публикуем строку: читатель, увидевший новый count, видит и ее
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const std::string& NameTable::name(std::uint32_t id) const {
+    static const std::string unknown = "?";
+    if (id >= count.load(std::memory_order_acquire)) {
+        return unknown;
+    }
+    const std::string* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk[id & (CHUNK_SIZE - 1)];
+}
@@ -1,38 +1,109 @@
 #include "../include/npc.h"
 #include "../include/visitor.h"
+#include "../include/spatial_grid.h"
+#include "../include/counter_rng.h"
+#include "../include/dungeon_stats.h"
 #include <cmath>
 #include <random>
 #include <iostream>
 
+bool npcTypeFromName(const std::string& name, NPCType& type) {
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        if (name == NPC_TYPE_INFO[i].name) {
+            type = static_cast<NPCType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Временный номер NPC вне подземелья. Через 2^31 - 1 созданий номера
+// идут по кругу; столько NPC одновременно без подземелья не бывает
+static std::uint32_t nextDetachedId() {
+    static std::atomic<std::uint32_t> counter{0};
+    const std::uint32_t range = NPCRef::NO_ID - NPCRef::DETACHED_ID_BASE;
+    return NPCRef::DETACHED_ID_BASE + counter.fetch_add(1, std::memory_order_relaxed) % range;
+}
+
 // Реализация базового класса NPC
-NPC::NPC(double x, double y, const std::string& name, int moveDist, int killDist) 
-    : x(x), y(y), name(name), alive(true), moveDistance(moveDist), killDistance(killDist) {}
+NPC::NPC(NPCType type, double x, double y, const std::string& name, int moveDist, int killDist) 
+    : type(type), id(NO_ID), x(x), y(y), nameId(NameTable::global().intern(name)), alive(true),
+      moveDistance(moveDist), killDistance(killDist), detachedId(nextDetachedId()) {}
+
+NPC::NPC(NPCType type, double x, double y, InternedName name, int moveDist, int killDist)
+    : type(type), id(NO_ID), x(x), y(y), nameId(name.id), alive(true), moveDistance(moveDist),
+      killDistance(killDist), detachedId(nextDetachedId()) {}
 
 double NPC::distanceTo(const NPC& other) const {
-    return std::sqrt(std::pow(x - other.x, 2) + std::pow(y - other.y, 2));
+    double dx = x - other.x;
+    double dy = y - other.y;
+    return std::sqrt(dx * dx + dy * dy);
 }
 
-void NPC::move(std::mt19937& gen) {
-    if (!alive) return;
+bool NPC::die() {
+    if (!alive.exchange(false)) return false;
+    if (stats) stats->onDeath(type);
+    return true;
+}
+
+bool NPC::step(std::mt19937& gen, const WorldBounds& bounds) {
+    if (!alive) return false;
     
     std::uniform_int_distribution<> moveDir(-moveDistance, moveDistance);
-    double newX = x + moveDir(gen);
-    double newY = y + moveDir(gen);
+    int dx = moveDir(gen);
+    int dy = moveDir(gen);
+    return tryMoveBy(dx, dy, bounds);
+}
+
+bool NPC::step(CounterRng& rng, const WorldBounds& bounds) {
+    if (!alive) return false;
     
-    // Проверка границ карты (0-100)
-    if (newX >= 0 && newX <= 100 && newY >= 0 && newY <= 100) {
+    int dx = rng.uniform(-moveDistance, moveDistance);
+    int dy = rng.uniform(-moveDistance, moveDistance);
+    return tryMoveBy(dx, dy, bounds);
+}
+
+bool NPC::tryMoveBy(int dx, int dy, const WorldBounds& bounds) {
+    double newX = x + dx;
+    double newY = y + dy;
+    
+    // Проверка границ карты
+    if (bounds.contains(newX, newY)) {
         x = newX;
         y = newY;
+        return true;
+    }
+    return false;
+}
+
+void NPC::move(std::mt19937& gen, const WorldBounds& bounds) {
+    if (step(gen, bounds) && grid) {
+        grid->update(this);
     }
 }
 
+void NPC::reindex() {
+    if (grid) grid->update(this);
+}
+
 void NPC::save(std::ostream& os) const {
-    os << getType() << " " << x << " " << y << " " << name;
+    // Номер пишется как "#id" после типа, чтобы старые файлы тоже читались
+    // Имя типа из таблицы, без виртуального вызова и временной строки
+    os << npcTypeInfo(type).name << " ";
+    if (id != NO_ID) {
+        os << "#" << id << " ";
+    }
+    os << x << " " << y << " " << getName();
 }
 
 // Реализация Dragon
 Dragon::Dragon(double x, double y, const std::string& name) 
-    : NPC(x, y, name, 50, 30) {}  // Дракон: ход 50, убийство 30
+    : NPC(NPCType::Dragon, x, y, name, npcTypeInfo(NPCType::Dragon).moveDistance,
+          npcTypeInfo(NPCType::Dragon).killDistance) {}  // Дракон: ход 50, убийство 30
+
+Dragon::Dragon(double x, double y, InternedName name)
+    : NPC(NPCType::Dragon, x, y, name, npcTypeInfo(NPCType::Dragon).moveDistance,
+          npcTypeInfo(NPCType::Dragon).killDistance) {}
 
 std::string Dragon::getType() const { return "Dragon"; }
 
@@ -40,14 +111,6 @@ void Dragon::accept(Visitor& visitor) {
     (void)visitor; // Подавление предупреждения
 }
 
-bool Dragon::canAttack(NPC* other) {
-    // Дракон может атаковать только быков
-    if (auto bull = dynamic_cast<Bull*>(other)) {
-        return true;
-    }
-    return false;
-}
-
 int Dragon::rollAttack(std::mt19937& gen) {
     std::uniform_int_distribution<> dist(1, 6);
     return dist(gen);
@@ -58,9 +121,22 @@ int Dragon::rollDefense(std::mt19937& gen) {
     return dist(gen);
 }
 
+int Dragon::rollAttack(CounterRng& rng) {
+    return rng.uniform(1, 6);
+}
+
+int Dragon::rollDefense(CounterRng& rng) {
+    return rng.uniform(1, 6);
+}
+
 // Реализация Bull
 Bull::Bull(double x, double y, const std::string& name) 
-    : NPC(x, y, name, 30, 10) {}  // Бык: ход 30, убийство 10
+    : NPC(NPCType::Bull, x, y, name, npcTypeInfo(NPCType::Bull).moveDistance,
+          npcTypeInfo(NPCType::Bull).killDistance) {}  // Бык: ход 30, убийство 10
+
+Bull::Bull(double x, double y, InternedName name)
+    : NPC(NPCType::Bull, x, y, name, npcTypeInfo(NPCType::Bull).moveDistance,
+          npcTypeInfo(NPCType::Bull).killDistance) {}
 
 std::string Bull::getType() const { return "Bull"; }
 
@@ -68,14 +144,6 @@ void Bull::accept(Visitor& visitor) {
     (void)visitor;
 }
 
-bool Bull::canAttack(NPC* other) {
-    // Бык может атаковать только жаб
-    if (auto toad = dynamic_cast<Toad*>(other)) {
-        return true;
-    }
-    return false;
-}
-
 int Bull::rollAttack(std::mt19937& gen) {
     std::uniform_int_distribution<> dist(1, 6);
     return dist(gen);
@@ -86,9 +154,22 @@ int Bull::rollDefense(std::mt19937& gen) {
     return dist(gen);
 }
 
+int Bull::rollAttack(CounterRng& rng) {
+    return rng.uniform(1, 6);
+}
+
+int Bull::rollDefense(CounterRng& rng) {
+    return rng.uniform(1, 6);
+}
+
 // Реализация Toad
 Toad::Toad(double x, double y, const std::string& name) 
-    : NPC(x, y, name, 1, 10) {}  // Жаба: ход 1, убийство 10
+    : NPC(NPCType::Toad, x, y, name, npcTypeInfo(NPCType::Toad).moveDistance,
+          npcTypeInfo(NPCType::Toad).killDistance) {}  // Жаба: ход 1, убийство 10
+
+Toad::Toad(double x, double y, InternedName name)
+    : NPC(NPCType::Toad, x, y, name, npcTypeInfo(NPCType::Toad).moveDistance,
+          npcTypeInfo(NPCType::Toad).killDistance) {}
 
 std::string Toad::getType() const { return "Toad"; }
 
@@ -96,12 +177,6 @@ void Toad::accept(Visitor& visitor) {
     (void)visitor;
 }
 
-bool Toad::canAttack(NPC* other) {
-    // Жабы никого не могут атаковать
-    (void)other;
-    return false;
-}
-
 int Toad::rollAttack(std::mt19937& gen) {
     std::uniform_int_distribution<> dist(1, 6);
     return dist(gen);
@@ -110,4 +185,12 @@ int Toad::rollAttack(std::mt19937& gen) {
 int Toad::rollDefense(std::mt19937& gen) {
     std::uniform_int_distribution<> dist(1, 6);
     return dist(gen);
+}
+
+int Toad::rollAttack(CounterRng& rng) {
+    return rng.uniform(1, 6);
+}
+
+int Toad::rollDefense(CounterRng& rng) {
+    return rng.uniform(1, 6);
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "../include/npc_arena.h"
+
+void* CountingResource::do_allocate(size_t size, size_t alignment) {
+    void* p = upstream->allocate(size, alignment);
+    total += size;
+    live += size;
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t size, size_t alignment) {
+    upstream->deallocate(p, size, alignment);
+    live -= size;
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+static std::pmr::pool_options arenaOptions() {
+    std::pmr::pool_options options;
+    options.max_blocks_per_chunk = NPCArena::SLAB_BYTES / 64;
+    options.largest_required_pool_block = 1024;
+    return options;
+}
+
+NPCArena::NPCArena()
+    : slabs(std::pmr::new_delete_resource()), pool(arenaOptions(), &slabs), used(&pool) {}
+
+bool NPCArena::release() {
+    if (getBytesLive() != 0) return false;
+    pool.release();
+    used.reset();
+    objects = 0;
+    return true;
+}
@@ -0,0 +1,156 @@
+#include "../include/npc_store.h"
+#include "../include/npc_arena.h"
+#include "../include/counter_rng.h"
+
+size_t NPCStore::add(NPCType type, double x, double y, const std::string& name, std::uint32_t id) {
+    return add(type, x, y, InternedName{NameTable::global().intern(name)}, id);
+}
+
+size_t NPCStore::add(NPCType type, double x, double y, InternedName name, std::uint32_t id) {
+    const NPCTypeInfo& info = npcTypeInfo(type);
+    xs.push_back(x);
+    ys.push_back(y);
+    alive.push_back(1);
+    types.push_back(type);
+    moveDistances.push_back(info.moveDistance);
+    killDistances.push_back(info.killDistance);
+    nameIds.push_back(name.id);
+    ids.push_back(id);
+    return xs.size() - 1;
+}
+
+void NPCStore::reserve(size_t count) {
+    xs.reserve(count);
+    ys.reserve(count);
+    alive.reserve(count);
+    types.reserve(count);
+    moveDistances.reserve(count);
+    killDistances.reserve(count);
+    nameIds.reserve(count);
+    ids.reserve(count);
+}
+
+void NPCStore::clear() {
+    xs.clear();
+    ys.clear();
+    alive.clear();
+    types.clear();
+    moveDistances.clear();
+    killDistances.clear();
+    nameIds.clear();
+    ids.clear();
+}
+
+void NPCStore::assignArrays(size_t count, const NPCType* typeArray, const std::uint8_t* aliveArray,
+                            const double* xArray, const double* yArray, const std::uint32_t* nameIndexArray,
+                            const std::vector<std::uint32_t>& nameIdTable, const std::uint32_t* idArray) {
+    xs.assign(xArray, xArray + count);
+    ys.assign(yArray, yArray + count);
+    alive.assign(aliveArray, aliveArray + count);
+    types.assign(typeArray, typeArray + count);
+    if (idArray) {
+        ids.assign(idArray, idArray + count);
+    } else {
+        ids.assign(count, NPC::NO_ID);
+    }
+
+    nameIds.resize(count);
+    moveDistances.resize(count);
+    killDistances.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        nameIds[i] = nameIdTable[nameIndexArray[i]];
+        const NPCTypeInfo& info = npcTypeInfo(types[i]);
+        moveDistances[i] = info.moveDistance;
+        killDistances[i] = info.killDistance;
+    }
+}
+
+void NPCStore::assign(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    clear();
+    reserve(npcs.size());
+    for (const auto& npc : npcs) {
+        size_t index = add(npc->getTypeTag(), npc->getX(), npc->getY(), InternedName{npc->getNameId()}, npc->getId());
+        // Дистанции берем из самого NPC, а не из таблицы типов
+        moveDistances[index] = npc->getMoveDistance();
+        killDistances[index] = npc->getKillDistance();
+        alive[index] = npc->isAlive() ? 1 : 0;
+    }
+}
+
+namespace {
+
+template <typename T>
+std::shared_ptr<NPC> makeNPC(NPCArena* arena, double x, double y, InternedName name) {
+    if (arena) return arena->make<T>(x, y, name);
+    return std::make_shared<T>(x, y, name);
+}
+
+} // namespace
+
+std::shared_ptr<NPC> NPCStore::toNPC(size_t index, NPCArena* arena) const {
+    // Имя уже в общей таблице - строка не собирается и не ищется заново
+    const InternedName name{nameIds[index]};
+    std::shared_ptr<NPC> npc;
+    switch (types[index]) {
+        case NPCType::Dragon:
+            npc = makeNPC<Dragon>(arena, xs[index], ys[index], name);
+            break;
+        case NPCType::Bull:
+            npc = makeNPC<Bull>(arena, xs[index], ys[index], name);
+            break;
+        case NPCType::Toad:
+            npc = makeNPC<Toad>(arena, xs[index], ys[index], name);
+            break;
+    }
+    npc->setId(ids[index]);
+    npc->setDistances(moveDistances[index], killDistances[index]);
+    if (!alive[index]) npc->die();
+    return npc;
+}
+
+std::vector<std::shared_ptr<NPC>> NPCStore::toNPCs(NPCArena* arena) const {
+    std::vector<std::shared_ptr<NPC>> result;
+    result.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        result.push_back(toNPC(i, arena));
+    }
+    return result;
+}
+
+size_t NPCStore::aliveCount() const {
+    size_t count = 0;
+    for (std::uint8_t a : alive) {
+        count += a;
+    }
+    return count;
+}
+
+bool NPCStore::tryMoveBy(size_t index, int dx, int dy, const WorldBounds& bounds) {
+    double newX = xs[index] + dx;
+    double newY = ys[index] + dy;
+
+    // Те же границы карты, что и в NPC::step
+    if (bounds.contains(newX, newY)) {
+        xs[index] = newX;
+        ys[index] = newY;
+        return true;
+    }
+    return false;
+}
+
+bool NPCStore::step(size_t index, std::mt19937& gen, const WorldBounds& bounds) {
+    if (!alive[index]) return false;
+
+    std::uniform_int_distribution<> moveDir(-moveDistances[index], moveDistances[index]);
+    int dx = moveDir(gen);
+    int dy = moveDir(gen);
+    return tryMoveBy(index, dx, dy, bounds);
+}
+
+bool NPCStore::step(size_t index, CounterRng& rng, const WorldBounds& bounds) {
+    if (!alive[index]) return false;
+
+    int dx = rng.uniform(-moveDistances[index], moveDistances[index]);
+    int dy = rng.uniform(-moveDistances[index], moveDistances[index]);
+    return tryMoveBy(index, dx, dy, bounds);
+}
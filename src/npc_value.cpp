@@ -0,0 +1,98 @@
+#include "../include/npc_value.h"
+#include "../include/factory.h"
+
+namespace value {
+
+namespace {
+
+template <NPCType Tag>
+NPCValue makeCreature(double x, double y, const std::string& name) {
+    Creature<Tag> creature;
+    creature.x = x;
+    creature.y = y;
+    creature.nameId = NameTable::global().intern(name);
+    return creature;
+}
+
+} // namespace
+
+NPCValue make(NPCType type, double x, double y, const std::string& name) {
+    switch (type) {
+        case NPCType::Dragon:
+            return makeCreature<NPCType::Dragon>(x, y, name);
+        case NPCType::Bull:
+            return makeCreature<NPCType::Bull>(x, y, name);
+        case NPCType::Toad:
+            return makeCreature<NPCType::Toad>(x, y, name);
+    }
+    return makeCreature<NPCType::Toad>(x, y, name);
+}
+
+NPCValue make(NPCType type, const Body& data) {
+    switch (type) {
+        case NPCType::Dragon: {
+            Dragon creature;
+            static_cast<Body&>(creature) = data;
+            return creature;
+        }
+        case NPCType::Bull: {
+            Bull creature;
+            static_cast<Body&>(creature) = data;
+            return creature;
+        }
+        case NPCType::Toad:
+            break;
+    }
+    Toad creature;
+    static_cast<Body&>(creature) = data;
+    return creature;
+}
+
+void save(std::ostream& os, const NPCValue& npc) {
+    const Body& data = body(npc);
+    os << typeName(npc) << " ";
+    if (data.id != NPC::NO_ID) {
+        os << "#" << data.id << " ";
+    }
+    os << data.x << " " << data.y << " " << NameTable::global().name(data.nameId);
+}
+
+NPCValue fromNPC(const NPC& npc) {
+    Body data;
+    data.id = npc.getId();
+    data.nameId = npc.getNameId();
+    data.x = npc.getX();
+    data.y = npc.getY();
+    data.alive = npc.isAlive();
+    return make(npc.getTypeTag(), data);
+}
+
+std::shared_ptr<NPC> toNPC(const NPCValue& npc) {
+    const Body& data = body(npc);
+    auto result = NPCFactory::createNPC(typeOf(npc), data.x, data.y, NameTable::global().name(data.nameId));
+    if (result) {
+        result->setId(data.id);
+        if (!data.alive) result->die();
+    }
+    return result;
+}
+
+std::vector<NPCValue> fromNPCs(const std::vector<std::shared_ptr<NPC>>& npcs) {
+    std::vector<NPCValue> result;
+    result.reserve(npcs.size());
+    for (const auto& npc : npcs) {
+        result.push_back(fromNPC(*npc));
+    }
+    return result;
+}
+
+std::vector<std::shared_ptr<NPC>> toNPCs(const std::vector<NPCValue>& npcs) {
+    std::vector<std::shared_ptr<NPC>> result;
+    result.reserve(npcs.size());
+    for (const auto& npc : npcs) {
+        result.push_back(toNPC(npc));
+    }
+    return result;
+}
+
+} // namespace value
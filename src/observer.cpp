@@ -1,48 +1,215 @@
 #include "../include/observer.h"
+#include "../include/event_log.h"
+#include <algorithm>
+#include <cstdio>
 
 // Реализация ConsoleObserver
-void ConsoleObserver::onFight(const std::string& attacker, const std::string& defender, bool defenderDied) {
+void ConsoleObserver::onFight(NPCRef attacker, NPCRef defender, bool defenderDied) {
     std::lock_guard<std::mutex> lock(coutMutex);
-    std::cout << "[БОЙ] " << attacker << " атакует " << defender;
-    if (defenderDied) {
-        std::cout << " и убивает!";
-    } else {
-        std::cout << ", но " << defender << " выживает!";
-    }
-    std::cout << std::endl;
+    writeFightText(std::cout, attacker.name(), defender.name(), defenderDied);
 }
 
-void ConsoleObserver::onMove(const std::string& npcName, double x, double y) {
+void ConsoleObserver::onMove(NPCRef npc, double x, double y) {
     // Не выводим перемещения чтобы не засорять консоль
     // std::lock_guard<std::mutex> lock(coutMutex);
-    // std::cout << "[ДВИЖЕНИЕ] " << npcName << " переместился в (" << x << ", " << y << ")" << std::endl;
+    // std::cout << "[ДВИЖЕНИЕ] " << npc.name() << " переместился в (" << x << ", " << y << ")\n";
 }
 
-void ConsoleObserver::onDie(const std::string& npcName) {
+void ConsoleObserver::onDie(NPCRef npc) {
     std::lock_guard<std::mutex> lock(coutMutex);
-    std::cout << "[СМЕРТЬ] " << npcName << " погиб!" << std::endl;
+    writeDieText(std::cout, npc.name());
+}
+
+void ConsoleObserver::flush() {
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cout.flush();
 }
 
 // Реализация FileObserver
-FileObserver::FileObserver() : file("log.txt", std::ios::app) {}
+FileObserver::FileObserver() : FileObserver(FileLogConfig()) {}
+
+FileObserver::FileObserver(const FileLogConfig& config)
+    : config(config), fileBytes(0), lastFlush(std::chrono::steady_clock::now()) {
+    openFile(config.truncate);
+}
 
-void FileObserver::onFight(const std::string& attacker, const std::string& defender, bool defenderDied) {
+FileObserver::~FileObserver() {
     std::lock_guard<std::mutex> lock(fileMutex);
-    file << "[БОЙ] " << attacker << " атакует " << defender;
-    if (defenderDied) {
-        file << " и убивает!";
+    writeOut();
+    file.flush();
+}
+
+void FileObserver::openFile(bool truncate) {
+    auto mode = std::ios::out | (truncate ? std::ios::trunc : std::ios::app);
+    if (config.format == FileLogConfig::Format::Binary) {
+        mode |= std::ios::binary;
+    }
+    file.open(config.path, mode);
+    file.seekp(0, std::ios::end);
+    fileBytes = static_cast<size_t>(std::max<std::streamoff>(0, file.tellp()));
+
+    // Таблица имен двоичного журнала начинается заново в каждом файле
+    namedIds.clear();
+    if (config.format == FileLogConfig::Format::Binary && fileBytes == 0) {
+        writeLogHeader(file);
+        fileBytes = static_cast<size_t>(file.tellp());
+    }
+}
+
+void FileObserver::rotate() {
+    file.close();
+
+    // log.txt.(N-1) -> log.txt.N, ..., log.txt -> log.txt.1
+    std::string oldest = config.path + "." + std::to_string(config.keepFiles);
+    std::remove(oldest.c_str());
+    for (size_t i = config.keepFiles; i > 1; --i) {
+        std::string from = config.path + "." + std::to_string(i - 1);
+        std::string to = config.path + "." + std::to_string(i);
+        std::rename(from.c_str(), to.c_str());
+    }
+    if (config.keepFiles > 0) {
+        std::string first = config.path + ".1";
+        std::rename(config.path.c_str(), first.c_str());
+    }
+
+    openFile(true);
+}
+
+void FileObserver::writeOut() {
+    std::string data = buffer.str();
+    if (data.empty()) return;
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    fileBytes += data.size();
+    buffer.str(std::string());
+}
+
+void FileObserver::beginRecord() {
+    // Ротацию делаем только на границе записей, пока буфер еще
+    // ссылается на таблицу имен текущего файла
+    if (config.rotateBytes > 0 && fileBytes + static_cast<size_t>(buffer.tellp()) >= config.rotateBytes) {
+        writeOut();
+        rotate();
+    }
+}
+
+void FileObserver::endRecord() {
+    if (static_cast<size_t>(buffer.tellp()) >= config.bufferSize) {
+        writeOut();
+    }
+}
+
+std::uint32_t FileObserver::idFor(NPCRef npc) {
+    // У NPC вне подземелья здесь его временный номер (NPC::ref)
+    const std::uint32_t id = npc.id;
+    // Первое упоминание NPC в файле: записываем его имя
+    if (namedIds.insert(id).second) {
+        LogRecord record;
+        record.type = LogRecord::Type::Name;
+        record.npc = id;
+        record.name = npc.name();
+        writeLogRecord(buffer, record);
+    }
+    return id;
+}
+
+void FileObserver::onFight(NPCRef attacker, NPCRef defender, bool defenderDied) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Fight;
+        record.npc = idFor(attacker);
+        record.target = idFor(defender);
+        record.defenderDied = defenderDied;
+        writeLogRecord(buffer, record);
+    } else {
+        writeFightText(buffer, attacker.name(), defender.name(), defenderDied);
+    }
+    endRecord();
+}
+
+void FileObserver::onMove(NPCRef npc, double x, double y) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Move;
+        record.npc = idFor(npc);
+        record.x = x;
+        record.y = y;
+        writeLogRecord(buffer, record);
     } else {
-        file << ", но " << defender << " выживает!";
+        writeMoveText(buffer, npc.name(), x, y);
     }
-    file << std::endl;
+    endRecord();
 }
 
-void FileObserver::onMove(const std::string& npcName, double x, double y) {
+void FileObserver::onDie(NPCRef npc) {
     std::lock_guard<std::mutex> lock(fileMutex);
-    file << "[ДВИЖЕНИЕ] " << npcName << " переместился в (" << x << ", " << y << ")" << std::endl;
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Die;
+        record.npc = idFor(npc);
+        writeLogRecord(buffer, record);
+    } else {
+        writeDieText(buffer, npc.name());
+    }
+    endRecord();
 }
 
-void FileObserver::onDie(const std::string& npcName) {
+void FileObserver::onSpawn(NPCRef npc, NPCType type, double x, double y, bool alive) {
     std::lock_guard<std::mutex> lock(fileMutex);
-    file << "[СМЕРТЬ] " << npcName << " погиб!" << std::endl;
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Spawn;
+        record.npc = idFor(npc);
+        record.npcType = static_cast<std::uint8_t>(type);
+        record.x = x;
+        record.y = y;
+        record.alive = alive;
+        writeLogRecord(buffer, record);
+    } else {
+        writeSpawnText(buffer, npc.name(), npcTypeInfo(type).name, x, y);
+    }
+    endRecord();
+}
+
+void FileObserver::onTick(std::uint64_t tick) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Tick;
+        record.tick = tick;
+        writeLogRecord(buffer, record);
+    } else {
+        writeTickText(buffer, tick);
+    }
+    endRecord();
+}
+
+void FileObserver::onRemove(NPCRef npc) {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    beginRecord();
+    if (config.format == FileLogConfig::Format::Binary) {
+        LogRecord record;
+        record.type = LogRecord::Type::Remove;
+        record.npc = idFor(npc);
+        writeLogRecord(buffer, record);
+    } else {
+        writeRemoveText(buffer, npc.name());
+    }
+    endRecord();
+}
+
+void FileObserver::flush() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastFlush < std::chrono::milliseconds(config.flushIntervalMs)) return;
+
+    writeOut();
+    file.flush();
+    lastFlush = now;
 }
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "../include/profiler.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+const char* PHASE_NAMES[PHASE_COUNT] = {
+    "tick", "move", "reindex", "encounter", "fight_submit", "fight_drain",
+    "fight_resolve", "dispatch", "map_render", "snapshot", "compaction",
+};
+
+const char* GAUGE_NAMES[GAUGE_COUNT] = {
+    "fight_queue_depth", "event_queue_depth", "alive_npcs",
+};
+
+unsigned highestBit(std::uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+double toSeconds(std::uint64_t nanoseconds) {
+    return nanoseconds / 1e9;
+}
+
+// Поток пишет только в свои гистограммы: хватает relaxed без read-modify-write
+void bump(std::atomic<std::uint64_t>& counter, std::uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+} // namespace
+
+const char* phaseName(Phase phase) {
+    return PHASE_NAMES[static_cast<size_t>(phase)];
+}
+
+const char* gaugeName(Gauge gauge) {
+    return GAUGE_NAMES[static_cast<size_t>(gauge)];
+}
+
+size_t LatencyHistogram::bucketFor(std::uint64_t nanoseconds) {
+    if (nanoseconds < 16) return static_cast<size_t>(nanoseconds);
+    unsigned exponent = highestBit(nanoseconds);
+    size_t sub = static_cast<size_t>((nanoseconds >> (exponent - 3)) & 7);
+    return std::min(BUCKETS - 1, 16 + (exponent - 4) * 8 + sub);
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < 16) return bucket;
+    unsigned exponent = static_cast<unsigned>(4 + (bucket - 16) / 8);
+    std::uint64_t sub = (bucket - 16) % 8;
+    std::uint64_t width = 1ull << (exponent - 3);
+    return (8 + sub) * width + width - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t nanoseconds) {
+    bump(buckets[bucketFor(nanoseconds)], 1);
+    bump(count, 1);
+    bump(sum, nanoseconds);
+    if (nanoseconds > max.load(std::memory_order_relaxed)) {
+        max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::mergeInto(LatencyHistogram& other) const {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        bump(other.buckets[i], buckets[i].load(std::memory_order_relaxed));
+    }
+    bump(other.count, getCount());
+    bump(other.sum, getSum());
+    other.max.store(std::max(other.getMax(), getMax()), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::quantile(double q) const {
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    // Ранг первого значения, не меньшего квантиля
+    std::uint64_t rank = static_cast<std::uint64_t>(q * (total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Граница корзины не может быть больше наибольшего замера
+            return std::min(bucketUpperBound(i), getMax());
+        }
+    }
+    return getMax();
+}
+
+Profiler::~Profiler() {
+    stopDump();
+}
+
+Profiler& Profiler::global() {
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::SlotOwner::~SlotOwner() {
+    if (slot) profiler->retireSlot(slot);
+}
+
+Profiler::ThreadSlot& Profiler::localSlot() {
+    thread_local SlotOwner owner;
+    if (!owner.slot) {
+        auto created = std::make_unique<ThreadSlot>();
+        owner.profiler = this;
+        owner.slot = created.get();
+        std::lock_guard<std::mutex> lock(slotsMutex);
+        slots.push_back(std::move(created));
+    }
+    return *owner.slot;
+}
+
+void Profiler::retireSlot(ThreadSlot* slot) {
+    std::lock_guard<std::mutex> lock(slotsMutex);
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        slot->phases[i].mergeInto(retired.phases[i]);
+    }
+    auto found = std::find_if(slots.begin(), slots.end(),
+                              [slot](const std::unique_ptr<ThreadSlot>& owned) { return owned.get() == slot; });
+    if (found != slots.end()) {
+        *found = std::move(slots.back());
+        slots.pop_back();
+    }
+}
+
+void Profiler::setGauge(Gauge gauge, std::int64_t value) {
+    const size_t index = static_cast<size_t>(gauge);
+    gauges[index].store(value, std::memory_order_relaxed);
+    std::int64_t previous = gaugeMax[index].load(std::memory_order_relaxed);
+    while (value > previous &&
+           !gaugeMax[index].compare_exchange_weak(previous, value, std::memory_order_relaxed)) {}
+}
+
+std::int64_t Profiler::getGauge(Gauge gauge) const {
+    return gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+}
+
+std::int64_t Profiler::getGaugeMax(Gauge gauge) const {
+    return gaugeMax[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+}
+
+PhaseSummary Profiler::summary(Phase phase) {
+    LatencyHistogram merged;
+    {
+        std::lock_guard<std::mutex> lock(slotsMutex);
+        retired.phases[static_cast<size_t>(phase)].mergeInto(merged);
+        for (const auto& slot : slots) {
+            slot->phases[static_cast<size_t>(phase)].mergeInto(merged);
+        }
+    }
+
+    PhaseSummary result;
+    result.count = merged.getCount();
+    result.totalSeconds = toSeconds(merged.getSum());
+    result.p50 = toSeconds(merged.quantile(0.5));
+    result.p99 = toSeconds(merged.quantile(0.99));
+    result.max = toSeconds(merged.getMax());
+    return result;
+}
+
+void Profiler::writePrometheus(std::ostream& os) {
+    os << std::setprecision(9);
+    os << "# HELP dungeon_phase_seconds Длительность фазы тика\n"
+       << "# TYPE dungeon_phase_seconds summary\n";
+    std::array<PhaseSummary, PHASE_COUNT> phases;
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        phases[i] = summary(static_cast<Phase>(i));
+        const char* name = PHASE_NAMES[i];
+        os << "dungeon_phase_seconds{phase=\"" << name << "\",quantile=\"0.5\"} " << phases[i].p50 << "\n"
+           << "dungeon_phase_seconds{phase=\"" << name << "\",quantile=\"0.99\"} " << phases[i].p99 << "\n"
+           << "dungeon_phase_seconds_sum{phase=\"" << name << "\"} " << phases[i].totalSeconds << "\n"
+           << "dungeon_phase_seconds_count{phase=\"" << name << "\"} " << phases[i].count << "\n";
+    }
+
+    os << "# HELP dungeon_phase_max_seconds Самый долгий замер фазы\n"
+       << "# TYPE dungeon_phase_max_seconds gauge\n";
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        os << "dungeon_phase_max_seconds{phase=\"" << PHASE_NAMES[i] << "\"} " << phases[i].max << "\n";
+    }
+
+    for (size_t i = 0; i < GAUGE_COUNT; ++i) {
+        const Gauge gauge = static_cast<Gauge>(i);
+        os << "# TYPE dungeon_" << GAUGE_NAMES[i] << " gauge\n"
+           << "dungeon_" << GAUGE_NAMES[i] << " " << getGauge(gauge) << "\n"
+           << "# TYPE dungeon_" << GAUGE_NAMES[i] << "_max gauge\n"
+           << "dungeon_" << GAUGE_NAMES[i] << "_max " << getGaugeMax(gauge) << "\n";
+    }
+}
+
+bool Profiler::dumpTo(const std::string& path) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file) return false;
+        writePrometheus(file);
+        if (!file) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) return false;
+    dumps++;
+    return true;
+}
+
+void Profiler::startDump(const std::string& path, std::chrono::milliseconds interval) {
+    stopDump();
+    std::lock_guard<std::mutex> lock(dumperMutex);
+    dumpPath = path;
+    dumpInterval = std::max(interval, std::chrono::milliseconds(1));
+    dumperStopping = false;
+    dumper = std::thread(&Profiler::dumpLoop, this);
+}
+
+void Profiler::stopDump() {
+    {
+        std::lock_guard<std::mutex> lock(dumperMutex);
+        if (!dumper.joinable()) return;
+        dumperStopping = true;
+    }
+    dumperCV.notify_one();
+    dumper.join();
+    dumpTo(dumpPath);
+}
+
+void Profiler::dumpLoop() {
+    std::unique_lock<std::mutex> lock(dumperMutex);
+    while (!dumperCV.wait_for(lock, dumpInterval, [this]() { return dumperStopping; })) {
+        lock.unlock();
+        dumpTo(dumpPath);
+        lock.lock();
+    }
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(slotsMutex);
+    for (auto& phase : retired.phases) {
+        phase.reset();
+    }
+    for (auto& slot : slots) {
+        for (auto& phase : slot->phases) {
+            phase.reset();
+        }
+    }
+    for (size_t i = 0; i < GAUGE_COUNT; ++i) {
+        gauges[i].store(0, std::memory_order_relaxed);
+        gaugeMax[i].store(0, std::memory_order_relaxed);
+    }
+}
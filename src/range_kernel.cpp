@@ -0,0 +1,137 @@
+#include "../include/range_kernel.h"
+
+// SSE2 входит в базовый набор x86-64
+#if defined(__x86_64__) || defined(_M_X64)
+#define RANGE_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2-вариант собирается с атрибутом target, поэтому весь проект
+// не требует -mavx2; включается он только после проверки процессора
+#if defined(RANGE_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RANGE_KERNEL_AVX2 1
+#define RANGE_KERNEL_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(RANGE_KERNEL_X86) && defined(__AVX2__)
+#define RANGE_KERNEL_AVX2 1
+#define RANGE_KERNEL_AVX2_TARGET
+#endif
+
+static std::uint64_t maskScalar(double x, double y, double radius2,
+                                const double* xs, const double* ys, size_t count) {
+    std::uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        double dx = xs[i] - x;
+        double dy = ys[i] - y;
+        if (dx * dx + dy * dy <= radius2) {
+            mask |= std::uint64_t(1) << i;
+        }
+    }
+    return mask;
+}
+
+#ifdef RANGE_KERNEL_X86
+static std::uint64_t maskSSE2(double x, double y, double radius2,
+                              const double* xs, const double* ys, size_t count) {
+    const __m128d ax = _mm_set1_pd(x);
+    const __m128d ay = _mm_set1_pd(y);
+    const __m128d r2 = _mm_set1_pd(radius2);
+
+    std::uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), ax);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), ay);
+        __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        std::uint64_t bits = static_cast<unsigned>(_mm_movemask_pd(_mm_cmple_pd(d2, r2)));
+        mask |= bits << i;
+    }
+    if (i < count) {
+        mask |= maskScalar(x, y, radius2, xs + i, ys + i, count - i) << i;
+    }
+    return mask;
+}
+#endif
+
+#ifdef RANGE_KERNEL_AVX2
+RANGE_KERNEL_AVX2_TARGET
+static std::uint64_t maskAVX2(double x, double y, double radius2,
+                              const double* xs, const double* ys, size_t count) {
+    const __m256d ax = _mm256_set1_pd(x);
+    const __m256d ay = _mm256_set1_pd(y);
+    const __m256d r2 = _mm256_set1_pd(radius2);
+
+    std::uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), ax);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), ay);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        std::uint64_t bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(d2, r2, _CMP_LE_OQ)));
+        mask |= bits << i;
+    }
+    if (i < count) {
+        mask |= maskScalar(x, y, radius2, xs + i, ys + i, count - i) << i;
+    }
+    return mask;
+}
+#endif
+
+bool rangeKernelSupported(RangeKernel kernel) {
+    switch (kernel) {
+        case RangeKernel::Scalar:
+            return true;
+        case RangeKernel::SSE2:
+#ifdef RANGE_KERNEL_X86
+            return true;
+#else
+            return false;
+#endif
+        case RangeKernel::AVX2:
+#if defined(RANGE_KERNEL_AVX2) && (defined(__GNUC__) || defined(__clang__))
+            return __builtin_cpu_supports("avx2");
+#elif defined(RANGE_KERNEL_AVX2)
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+RangeKernel activeRangeKernel() {
+    static const RangeKernel kernel = rangeKernelSupported(RangeKernel::AVX2) ? RangeKernel::AVX2
+                                    : rangeKernelSupported(RangeKernel::SSE2) ? RangeKernel::SSE2
+                                    : RangeKernel::Scalar;
+    return kernel;
+}
+
+const char* rangeKernelName(RangeKernel kernel) {
+    switch (kernel) {
+        case RangeKernel::Scalar: return "scalar";
+        case RangeKernel::SSE2: return "sse2";
+        case RangeKernel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+std::uint64_t inRangeMask(RangeKernel kernel, double x, double y, double radius2,
+                          const double* xs, const double* ys, size_t count) {
+    switch (kernel) {
+#ifdef RANGE_KERNEL_AVX2
+        case RangeKernel::AVX2:
+            return maskAVX2(x, y, radius2, xs, ys, count);
+#endif
+#ifdef RANGE_KERNEL_X86
+        case RangeKernel::SSE2:
+            return maskSSE2(x, y, radius2, xs, ys, count);
+#endif
+        default:
+            return maskScalar(x, y, radius2, xs, ys, count);
+    }
+}
+
+std::uint64_t inRangeMask(double x, double y, double radius2,
+                          const double* xs, const double* ys, size_t count) {
+    static const RangeKernel kernel = activeRangeKernel();
+    return inRangeMask(kernel, x, y, radius2, xs, ys, count);
+}
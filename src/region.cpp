@@ -0,0 +1,493 @@
+#include "../include/region.h"
+#include "../include/dungeon.h"
+#include "../include/counter_rng.h"
+#include "../include/npc_value.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define DUNGEON_HAS_REGIONS 1
+#endif
+
+#ifdef DUNGEON_HAS_REGIONS
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// Запись о NPC в сообщении: id, имя, тип, жив ли, координаты.
+// Процессы - копии одной программы на одной машине, поэтому числа
+// пишутся в родном порядке байт
+const size_t RECORD_BYTES = 4 + 4 + 1 + 1 + 8 + 8;
+
+class MessageWriter {
+private:
+    std::string data;
+
+public:
+    template <typename T>
+    void put(const T& value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void putNPCs(const std::vector<value::NPCValue>& npcs) {
+        put(static_cast<std::uint64_t>(npcs.size()));
+        data.reserve(data.size() + npcs.size() * RECORD_BYTES);
+        for (const auto& npc : npcs) {
+            const value::Body& fields = value::body(npc);
+            put(fields.id);
+            put(fields.nameId);
+            put(static_cast<std::uint8_t>(value::typeOf(npc)));
+            put(static_cast<std::uint8_t>(fields.alive ? 1 : 0));
+            put(fields.x);
+            put(fields.y);
+        }
+    }
+    std::string& str() { return data; }
+};
+
+class MessageReader {
+private:
+    const std::string& data;
+    size_t offset = 0;
+    bool failed = false;
+
+public:
+    explicit MessageReader(const std::string& data) : data(data) {}
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (offset + sizeof(T) > data.size()) {
+            failed = true;
+            return value;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+    bool getNPCs(std::vector<value::NPCValue>& npcs) {
+        auto count = get<std::uint64_t>();
+        if (failed || count > (data.size() - offset) / RECORD_BYTES) return false;
+        npcs.reserve(npcs.size() + count);
+        for (std::uint64_t i = 0; i < count; ++i) {
+            value::Body body;
+            body.id = get<std::uint32_t>();
+            body.nameId = get<std::uint32_t>();
+            auto type = get<std::uint8_t>();
+            body.alive = get<std::uint8_t>() != 0;
+            body.x = get<double>();
+            body.y = get<double>();
+            if (type >= NPC_TYPE_COUNT) return false;
+            npcs.push_back(value::make(static_cast<NPCType>(type), body));
+        }
+        return !failed;
+    }
+    bool ok() const { return !failed; }
+};
+
+// Сообщения в сокете: длина (8 байт), затем содержимое.
+// Обмен с соседом полнодуплексный: оба конца одновременно пишут и читают
+// через poll, поэтому большие сообщения не зацикливаются на заполненных
+// буферах сокетов. false - сосед закрыл сокет или ошибка
+bool exchange(int fd, const std::string& out, std::string& in) {
+    const std::uint64_t outSize = out.size();
+    std::string frame(reinterpret_cast<const char*>(&outSize), sizeof(outSize));
+    frame += out;
+
+    size_t sent = 0;
+    char header[sizeof(std::uint64_t)];
+    size_t headerRead = 0;
+    std::uint64_t inSize = 0;
+    size_t bodyRead = 0;
+    in.clear();
+
+    auto receivedAll = [&]() { return headerRead == sizeof(header) && bodyRead == inSize; };
+    while (sent < frame.size() || !receivedAll()) {
+        pollfd entry{fd, 0, 0};
+        if (!receivedAll()) entry.events |= POLLIN;
+        if (sent < frame.size()) entry.events |= POLLOUT;
+        if (poll(&entry, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (entry.revents & POLLOUT) {
+            ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, SEND_FLAGS);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+            if (n > 0) sent += static_cast<size_t>(n);
+        }
+        if (entry.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n;
+            if (headerRead < sizeof(header)) {
+                n = recv(fd, header + headerRead, sizeof(header) - headerRead, 0);
+            } else {
+                n = recv(fd, &in[bodyRead], inSize - bodyRead, 0);
+            }
+            if (n == 0) return false;
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+                return false;
+            }
+            if (headerRead < sizeof(header)) {
+                headerRead += static_cast<size_t>(n);
+                if (headerRead == sizeof(header)) {
+                    std::memcpy(&inSize, header, sizeof(inSize));
+                    in.resize(inSize);
+                }
+            } else {
+                bodyRead += static_cast<size_t>(n);
+            }
+        }
+    }
+    return true;
+}
+
+bool prepareSocket(int fd) {
+#ifdef SO_NOSIGPIPE
+    // Без MSG_NOSIGNAL запись в закрытый сокет иначе убила бы процесс
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Полоса [minX, maxX) каждого региона; последняя включает правый край мира
+struct Strips {
+    double width = 0;
+    size_t count = 1;
+
+    double minX(size_t region) const { return width * region; }
+    double maxX(size_t region) const { return width * (region + 1); }
+    size_t owner(double x) const {
+        if (!(x > 0)) return 0;
+        return std::min(count - 1, static_cast<size_t>(x / width));
+    }
+};
+
+// Концы сокетов одного процесса региона (-1 - соседа нет)
+struct RegionLinks {
+    int left = -1;
+    int right = -1;
+    int control = -1;
+};
+
+std::string encodeResult(Dungeon& dungeon, const RegionStats& stats) {
+    MessageWriter writer;
+    writer.put(stats.migratedOut);
+    writer.put(stats.ghostsSent);
+    writer.put(stats.bytesSent);
+    writer.put(stats.wallSeconds);
+    writer.put(stats.exchangeSeconds);
+
+    StatsSnapshot snapshot = dungeon.getStats();
+    writer.put(snapshot.fights);
+    for (const auto& row : snapshot.killsByPair) {
+        for (std::uint64_t kills : row) {
+            writer.put(kills);
+        }
+    }
+    writer.putNPCs(dungeon.copyNPCsIf([](const NPC&) { return true; }));
+    return std::move(writer.str());
+}
+
+// Тело процесса региона; код выхода для waitpid
+int runRegion(const RegionConfig& config, const Strips& strips, size_t index,
+              const std::vector<value::NPCValue>& all, const RegionLinks& links) {
+    Dungeon dungeon;
+    if (config.deterministic) {
+        dungeon.setSeed(config.seed);
+    } else if (config.seeded) {
+        // Иначе у всех регионов совпали бы потоки случайных чисел
+        dungeon.setSeed(config.seed + static_cast<unsigned>(index) * 7919u);
+    }
+    dungeon.setDeterministic(config.deterministic);
+    dungeon.setMovementThreads(config.threadsPerRegion);
+    dungeon.setFightThreads(config.threadsPerRegion, 65536);
+    dungeon.setWorldConfig(config.world);
+    dungeon.setCompaction(config.compactDeadFraction, 64);
+
+    std::vector<value::NPCValue> owned;
+    for (const auto& npc : all) {
+        if (strips.owner(value::body(npc).x) == index) {
+            owned.push_back(npc);
+        }
+    }
+    dungeon.addNPCs(owned);
+    owned = {};
+
+    const double minX = strips.minX(index);
+    const double maxX = strips.maxX(index);
+    const double halo = config.world.getMaxKillDistance();
+    RegionStats stats;
+
+    // Обмен с обоими соседями: каждому уходит то из out, для чего
+    // toSide(npc, сторона) истинно (0 - левый, 1 - правый), полученное
+    // дописывается в in. Четные регионы сначала обмениваются с левым
+    // соседом, нечетные - с правым: пары обмениваются одновременно, а не
+    // волной вдоль полос. 0 или код выхода процесса
+    std::string received;
+    auto exchangeSides = [&](const std::vector<value::NPCValue>& out, auto&& toSide,
+                             std::vector<value::NPCValue>& in, std::uint64_t& sentCount) {
+        for (int step = 0; step < 2; ++step) {
+            const int side = index % 2 == 0 ? step : 1 - step;
+            const int fd = side == 0 ? links.left : links.right;
+            if (fd < 0) continue;
+
+            std::vector<value::NPCValue> part;
+            for (const auto& npc : out) {
+                if (toSide(npc, side)) part.push_back(npc);
+            }
+            MessageWriter writer;
+            writer.putNPCs(part);
+            if (!exchange(fd, writer.str(), received)) return 2;
+            sentCount += part.size();
+            stats.bytesSent += writer.str().size() + sizeof(std::uint64_t);
+
+            MessageReader reader(received);
+            if (!reader.getNPCs(in)) return 3;
+        }
+        return 0;
+    };
+
+    dungeon.startStepping();
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<value::NPCValue> arrived, ghosts;
+    for (std::uint64_t t = 0; t < config.ticks; ++t) {
+        dungeon.stepMovement();
+
+        // Ушедшие за границы полосы переходят к соседу до боев: бьются
+        // и гибнут они уже там, где стоят
+        auto exchangeStart = std::chrono::steady_clock::now();
+        std::vector<value::NPCValue> leaving = dungeon.takeNPCsIf([&](const NPC& npc) {
+            return strips.owner(npc.getX()) != index;
+        });
+        arrived.clear();
+        int code = exchangeSides(leaving, [&](const value::NPCValue& npc, int side) {
+            return (strips.owner(value::body(npc).x) < index) == (side == 0);
+        }, arrived, stats.migratedOut);
+        if (code != 0) return code;
+        dungeon.addNPCs(arrived);
+        stats.exchangeSeconds +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - exchangeStart).count();
+
+        dungeon.stepFights();
+
+        // Атакующие у границ после своих боев: погибший в этом тике дома
+        // соседу уже не достается и не бьет там. Пришедшие от соседа
+        // атакующие стоят у границы и уходят к нему копиями отсюда
+        exchangeStart = std::chrono::steady_clock::now();
+        std::vector<value::NPCValue> border = dungeon.copyNPCsIf([&](const NPC& npc) {
+            return npc.isAlive() && canTypeAttackAny(npc.getTypeTag()) &&
+                   (npc.getX() < minX + halo || npc.getX() >= maxX - halo);
+        });
+        ghosts.clear();
+        code = exchangeSides(border, [&](const value::NPCValue& npc, int side) {
+            const double x = value::body(npc).x;
+            return side == 0 ? x < minX + halo : x >= maxX - halo;
+        }, ghosts, stats.ghostsSent);
+        if (code != 0) return code;
+        dungeon.setGhosts(ghosts);
+        stats.exchangeSeconds +=
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - exchangeStart).count();
+
+        dungeon.stepGhostFights();
+    }
+    stats.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    dungeon.stopGame();
+
+    std::string unused;
+    return exchange(links.control, encodeResult(dungeon, stats), unused) ? 0 : 4;
+}
+
+bool decodeResult(const std::string& data, RegionStats& stats, RegionReport& report,
+                  std::vector<value::NPCValue>& npcs) {
+    MessageReader reader(data);
+    stats.migratedOut = reader.get<std::uint64_t>();
+    stats.ghostsSent = reader.get<std::uint64_t>();
+    stats.bytesSent = reader.get<std::uint64_t>();
+    stats.wallSeconds = reader.get<double>();
+    stats.exchangeSeconds = reader.get<double>();
+
+    report.fights += reader.get<std::uint64_t>();
+    for (auto& row : report.killsByPair) {
+        for (std::uint64_t& kills : row) {
+            kills += reader.get<std::uint64_t>();
+        }
+    }
+
+    const size_t before = npcs.size();
+    if (!reader.getNPCs(npcs)) return false;
+    stats.total = npcs.size() - before;
+    stats.alive = static_cast<size_t>(std::count_if(npcs.begin() + before, npcs.end(),
+        [](const value::NPCValue& npc) { return value::body(npc).alive; }));
+    return reader.ok();
+}
+
+void closeAll(std::vector<int>& fds) {
+    for (int& fd : fds) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+}
+
+} // namespace
+
+bool runRegions(const RegionConfig& config, RegionReport& report, std::string& error) {
+    report = RegionReport{};
+    if (config.regions < 1 || config.regions > 256) {
+        error = "число регионов должно быть от 1 до 256";
+        return false;
+    }
+    if (!config.world.validate(error)) return false;
+
+    Strips strips{config.world.width / config.regions, config.regions};
+    const int maxMove = *std::max_element(config.world.moveDistance.begin(), config.world.moveDistance.end());
+    const int maxKill = config.world.getMaxKillDistance();
+    if (config.regions > 1 && strips.width < maxMove + maxKill) {
+        error = "полоса региона (" + std::to_string(strips.width) +
+                ") уже суммы наибольших дистанций хода и убийства (" + std::to_string(maxMove + maxKill) +
+                "): увеличьте width или уменьшите число регионов";
+        return false;
+    }
+
+    // Мир создается до fork так же, как в spawnRandomNPCs: с тем же зерном
+    // расстановка совпадает с обычным прогоном, имена уже в общей таблице
+    std::vector<value::NPCValue> all;
+    {
+        Dungeon spawner;
+        if (config.seeded || config.deterministic) {
+            spawner.setSeed(config.seed);
+        }
+        spawner.setWorldConfig(config.world);
+        spawner.spawnRandomNPCs(config.world.spawnCount);
+        all = value::fromNPCs(spawner.getNPCs());
+    }
+
+    // links[i] соединяет регион i (конец 0) с регионом i + 1 (конец 1)
+    std::vector<int> fds;
+    std::vector<std::array<int, 2>> links(config.regions - 1);
+    std::vector<std::array<int, 2>> controls(config.regions);
+    auto makePair = [&](std::array<int, 2>& pair) {
+        int raw[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, raw) != 0) return false;
+        pair = {raw[0], raw[1]};
+        fds.push_back(raw[0]);
+        fds.push_back(raw[1]);
+        return prepareSocket(raw[0]) && prepareSocket(raw[1]);
+    };
+    for (auto& pair : links) {
+        if (!makePair(pair)) {
+            closeAll(fds);
+            error = std::string("socketpair: ") + std::strerror(errno);
+            return false;
+        }
+    }
+    for (auto& pair : controls) {
+        if (!makePair(pair)) {
+            closeAll(fds);
+            error = std::string("socketpair: ") + std::strerror(errno);
+            return false;
+        }
+    }
+
+    std::vector<pid_t> children;
+    for (size_t i = 0; i < config.regions; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            error = std::string("fork: ") + std::strerror(errno);
+            break;
+        }
+        if (pid == 0) {
+            RegionLinks own;
+            own.left = i > 0 ? links[i - 1][1] : -1;
+            own.right = i + 1 < config.regions ? links[i][0] : -1;
+            own.control = controls[i][1];
+            for (int fd : fds) {
+                if (fd != own.left && fd != own.right && fd != own.control) close(fd);
+            }
+            // _exit: деструкторы и atexit копии родителя здесь не нужны
+            _exit(runRegion(config, strips, i, all, own));
+        }
+        children.push_back(pid);
+    }
+
+    // У родителя остаются только свои концы управляющих сокетов
+    std::vector<int> parentEnds;
+    for (int fd : fds) {
+        bool own = false;
+        for (const auto& pair : controls) {
+            own = own || fd == pair[0];
+        }
+        if (own) {
+            parentEnds.push_back(fd);
+        } else {
+            close(fd);
+        }
+    }
+
+    bool ok = children.size() == config.regions;
+    std::vector<value::NPCValue> npcs;
+    npcs.reserve(all.size());
+    all = {};
+    report.regions.resize(config.regions);
+    for (size_t i = 0; ok && i < config.regions; ++i) {
+        RegionStats& stats = report.regions[i];
+        stats.minX = strips.minX(i);
+        stats.maxX = i + 1 < config.regions ? strips.maxX(i) : config.world.width;
+        std::string result;
+        if (!exchange(controls[i][0], "", result) || !decodeResult(result, stats, report, npcs)) {
+            error = "регион " + std::to_string(i) + " не прислал итоги";
+            ok = false;
+        }
+    }
+    closeAll(parentEnds);
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        int status = 0;
+        while (waitpid(children[i], &status, 0) < 0 && errno == EINTR) {}
+        if (ok && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+            error = "процесс региона " + std::to_string(i) + " завершился с ошибкой";
+            ok = false;
+        }
+    }
+    if (!ok) return false;
+
+    // Общий мир по возрастанию id - тот же порядок, что у одного подземелья
+    std::sort(npcs.begin(), npcs.end(), [](const value::NPCValue& a, const value::NPCValue& b) {
+        return value::body(a).id < value::body(b).id;
+    });
+    report.checksum = npcs.size();
+    for (const auto& npc : npcs) {
+        const value::Body& data = value::body(npc);
+        report.checksum = mixNPCState(report.checksum, data.id, data.x, data.y, data.alive);
+        if (data.alive) report.alive++;
+    }
+    report.total = npcs.size();
+    report.ticks = config.ticks;
+    for (const RegionStats& stats : report.regions) {
+        report.wallSeconds = std::max(report.wallSeconds, stats.wallSeconds);
+    }
+    report.ticksPerSecond = report.wallSeconds > 0 ? report.ticks / report.wallSeconds : 0;
+    return true;
+}
+
+#else
+
+bool runRegions(const RegionConfig&, RegionReport& report, std::string& error) {
+    report = RegionReport{};
+    error = "режим регионов требует fork и Unix-сокетов";
+    return false;
+}
+
+#endif
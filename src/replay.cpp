@@ -0,0 +1,204 @@
+#include "../include/replay.h"
+#include "../include/counter_rng.h"
+#include <algorithm>
+
+void ReplayState::apply(const LogRecord& record, const EventLogReader& reader) {
+    const std::uint32_t id = record.npc;
+    const bool known = id < present.size() && present[id];
+
+    switch (record.type) {
+        case LogRecord::Type::Name:
+            break;
+        case LogRecord::Type::Spawn: {
+            // Номера, выданные самим журналом, мир не восстанавливают
+            if (id >= LOG_LOCAL_ID_BASE) break;
+            if (id >= npcs.size()) {
+                npcs.resize(static_cast<size_t>(id) + 1);
+                present.resize(npcs.size(), 0);
+            }
+            value::Body data;
+            data.id = id;
+            data.nameId = NameTable::global().intern(reader.nameOf(id));
+            data.x = record.x;
+            data.y = record.y;
+            data.alive = record.alive;
+            npcs[id] = value::make(static_cast<NPCType>(record.npcType), data);
+            present[id] = 1;
+            break;
+        }
+        case LogRecord::Type::Move:
+            if (known) {
+                value::Body& data = value::body(npcs[id]);
+                data.x = record.x;
+                data.y = record.y;
+            }
+            break;
+        case LogRecord::Type::Fight:
+            fights++;
+            // Убийство засчитывается первому бою, убившему живого защитника,
+            // как и в DungeonStats; запись Die после этого ничего не меняет
+            if (record.defenderDied && known && record.target < present.size() && present[record.target]) {
+                value::Body& defender = value::body(npcs[record.target]);
+                if (defender.alive) {
+                    defender.alive = false;
+                    killsByPair[static_cast<size_t>(value::typeOf(npcs[id]))]
+                               [static_cast<size_t>(value::typeOf(npcs[record.target]))]++;
+                }
+            }
+            break;
+        case LogRecord::Type::Die:
+            if (known) {
+                value::body(npcs[id]).alive = false;
+            }
+            break;
+        case LogRecord::Type::Tick:
+            tick = record.tick;
+            break;
+        case LogRecord::Type::Remove:
+            if (known) {
+                present[id] = 0;
+            }
+            break;
+    }
+}
+
+size_t ReplayState::getNPCCount() const {
+    return static_cast<size_t>(std::count(present.begin(), present.end(), 1));
+}
+
+size_t ReplayState::getAliveCount() const {
+    size_t alive = 0;
+    for (size_t id = 0; id < npcs.size(); ++id) {
+        if (present[id] && value::body(npcs[id]).alive) alive++;
+    }
+    return alive;
+}
+
+size_t ReplayState::getAliveCount(NPCType type) const {
+    size_t alive = 0;
+    for (size_t id = 0; id < npcs.size(); ++id) {
+        if (present[id] && value::typeOf(npcs[id]) == type && value::body(npcs[id]).alive) alive++;
+    }
+    return alive;
+}
+
+std::vector<value::NPCValue> ReplayState::world() const {
+    std::vector<value::NPCValue> result;
+    for (size_t id = 0; id < npcs.size(); ++id) {
+        if (present[id]) result.push_back(npcs[id]);
+    }
+    return result;
+}
+
+std::uint64_t ReplayState::checksum() const {
+    std::uint64_t hash = getNPCCount();
+    for (size_t id = 0; id < npcs.size(); ++id) {
+        if (!present[id]) continue;
+        const value::Body& data = value::body(npcs[id]);
+        hash = mixNPCState(hash, data.id, data.x, data.y, data.alive);
+    }
+    return hash;
+}
+
+size_t ReplayState::memoryBytes() const {
+    return sizeof(ReplayState) + npcs.capacity() * sizeof(value::NPCValue) + present.capacity();
+}
+
+ReplayEngine::ReplayEngine(std::uint64_t keyframeInterval, size_t keyframeBudget)
+    : keyframeInterval(std::max<std::uint64_t>(1, keyframeInterval)), keyframeBudget(keyframeBudget),
+      keyframeBytes(0), firstTick(0), lastTick(0), position(0), recordsRead(0) {}
+
+void ReplayEngine::addKeyframe(std::uint64_t offset) {
+    keyframes.push_back({state.tick, offset, state});
+    keyframeBytes += keyframes.back().state.memoryBytes();
+
+    // Первый кадр остается всегда: без него ранние тики недостижимы
+    while (keyframeBytes > keyframeBudget && keyframes.size() > 2) {
+        std::vector<Keyframe> kept;
+        kept.reserve(keyframes.size() / 2 + 1);
+        keyframeBytes = 0;
+        for (size_t i = 0; i < keyframes.size(); i += 2) {
+            keyframeBytes += keyframes[i].state.memoryBytes();
+            kept.push_back(std::move(keyframes[i]));
+        }
+        keyframes = std::move(kept);
+        keyframeInterval *= 2;
+    }
+}
+
+bool ReplayEngine::open(const std::string& path) {
+    keyframes.clear();
+    keyframeBytes = 0;
+    state = ReplayState();
+    firstTick = lastTick = 0;
+    recordsRead = 0;
+    if (!reader.open(path)) return false;
+
+    // Один проход по всему журналу: итоговый мир и ключевые кадры
+    bool spawned = false, ticked = false;
+    LogRecord record;
+    while (true) {
+        std::uint64_t offset = reader.tell();
+        if (!reader.next(record)) {
+            position = offset;
+            break;
+        }
+        if (record.type == LogRecord::Type::Spawn) {
+            spawned = true;
+        } else if (record.type == LogRecord::Type::Tick) {
+            // Мир перед записью Tick(n) - это конец тика n - 1
+            if (!ticked) {
+                ticked = true;
+                firstTick = record.tick > 0 ? record.tick - 1 : 0;
+                state.tick = firstTick;
+                addKeyframe(offset);
+            } else if (state.tick >= keyframes.back().tick + keyframeInterval) {
+                addKeyframe(offset);
+            }
+            lastTick = record.tick;
+        }
+        state.apply(record, reader);
+        recordsRead++;
+    }
+    if (!spawned) return false;
+
+    if (!ticked) {
+        // Запись без единого тика: есть только начальный мир
+        firstTick = lastTick = state.tick;
+        addKeyframe(position);
+    }
+    return true;
+}
+
+bool ReplayEngine::seek(std::uint64_t tick) {
+    if (keyframes.empty() || tick < firstTick || tick > lastTick) return false;
+    recordsRead = 0;
+    if (state.tick == tick) return true;
+
+    // Ближайший кадр не позже tick; если текущий мир ближе, идем от него
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), tick,
+                                     [](std::uint64_t value, const Keyframe& frame) { return value < frame.tick; });
+    --keyframe;
+    if (state.tick < tick && state.tick >= keyframe->tick) {
+        reader.seek(position);
+    } else {
+        state = keyframe->state;
+        reader.seek(keyframe->offset);
+    }
+
+    LogRecord record;
+    while (true) {
+        std::uint64_t offset = reader.tell();
+        if (!reader.next(record)) {
+            position = offset;
+            break;
+        }
+        if (record.type == LogRecord::Type::Tick && record.tick > tick) {
+            position = offset;
+            break;
+        }
+        state.apply(record, reader);
+        recordsRead++;
+    }
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "../include/scheduler.h"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+void Task::promise_type::unhandled_exception() noexcept {
+    std::terminate();
+}
+
+Task::promise_type::~promise_type() {
+    if (scheduler) {
+        scheduler->liveTasks.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+Task::~Task() {
+    // Задача, которую так и не отдали планировщику
+    if (handle) handle.destroy();
+}
+
+Scheduler::Scheduler(size_t threads, Clock::duration resolution)
+    : threadCount(std::max<size_t>(1, threads)), wheelStart(Clock::now()),
+      resolution(std::max<Clock::duration>(resolution, Clock::duration(1))),
+      wheelTick(0), timerCount(0), stopping(false), liveTasks(0), resumed(0) {
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&Scheduler::workerLoop, this);
+    }
+    timerThread = std::thread(&Scheduler::timerLoop, this);
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+void Scheduler::spawn(Task task) {
+    std::coroutine_handle<Task::promise_type> handle = std::exchange(task.handle, nullptr);
+    if (!handle) return;
+    handle.promise().scheduler = this;
+    liveTasks.fetch_add(1, std::memory_order_relaxed);
+    if (isStopping()) {
+        handle.destroy();
+        return;
+    }
+    post(handle);
+}
+
+void Scheduler::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        ready.push_back(handle);
+    }
+    readyCV.notify_one();
+}
+
+void Scheduler::postBatch(std::vector<std::coroutine_handle<>>& handles) {
+    if (handles.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        ready.insert(ready.end(), handles.begin(), handles.end());
+    }
+    if (handles.size() == 1) {
+        readyCV.notify_one();
+    } else {
+        readyCV.notify_all();
+    }
+    handles.clear();
+}
+
+void Scheduler::addTimer(std::coroutine_handle<> handle, Clock::time_point when) {
+    // Округляем вверх: задача не просыпается раньше срока
+    const auto offset = (when - wheelStart).count();
+    const auto step = resolution.count();
+    const std::uint64_t due = offset > 0 ? static_cast<std::uint64_t>((offset + step - 1) / step) : 0;
+
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock(wheelMutex);
+        if (due <= wheelTick) {
+            lock.unlock();
+            post(handle);
+            return;
+        }
+        wheel[due % WHEEL_SLOTS].push_back(Timer{handle, due});
+        // Пустое колесо поток таймеров не крутит - его надо разбудить
+        wake = timerCount++ == 0;
+    }
+    if (wake) wheelCV.notify_one();
+}
+
+void Scheduler::advanceWheel(std::uint64_t upTo, std::vector<std::coroutine_handle<>>& expired) {
+    if (upTo <= wheelTick) return;
+    // Отстали больше чем на оборот - достаточно пройти каждую ячейку один раз
+    const std::uint64_t steps = std::min<std::uint64_t>(upTo - wheelTick, WHEEL_SLOTS);
+    for (std::uint64_t i = 1; i <= steps && timerCount > 0; ++i) {
+        std::vector<Timer>& cell = wheel[(wheelTick + i) % WHEEL_SLOTS];
+        // В ячейке лежат и сроки следующих оборотов, их оставляем
+        for (size_t j = 0; j < cell.size();) {
+            if (cell[j].due <= upTo) {
+                expired.push_back(cell[j].handle);
+                cell[j] = cell.back();
+                cell.pop_back();
+                timerCount--;
+            } else {
+                ++j;
+            }
+        }
+    }
+    wheelTick = upTo;
+}
+
+void Scheduler::timerLoop() {
+    std::vector<std::coroutine_handle<>> expired;
+    std::unique_lock<std::mutex> lock(wheelMutex);
+    while (!isStopping()) {
+        if (timerCount == 0) {
+            wheelCV.wait(lock, [this]() { return isStopping() || timerCount > 0; });
+            continue;
+        }
+        wheelCV.wait_until(lock, wheelStart + resolution * (wheelTick + 1),
+                           [this]() { return isStopping(); });
+        if (isStopping()) break;
+
+        auto now = static_cast<std::uint64_t>((Clock::now() - wheelStart) / resolution);
+        advanceWheel(now, expired);
+        if (!expired.empty()) {
+            lock.unlock();
+            postBatch(expired);
+            lock.lock();
+        }
+    }
+}
+
+void Scheduler::workerLoop() {
+    std::vector<std::coroutine_handle<>> batch;
+    batch.reserve(BATCH_SIZE);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(readyMutex);
+            readyCV.wait(lock, [this]() { return isStopping() || !ready.empty(); });
+            if (isStopping()) return;
+            // Пачкой, но не больше своей доли: остальным потокам тоже хватит
+            size_t take = std::min(BATCH_SIZE, std::max<size_t>(1, ready.size() / threadCount));
+            batch.assign(ready.begin(), ready.begin() + take);
+            ready.erase(ready.begin(), ready.begin() + take);
+        }
+        for (std::coroutine_handle<> handle : batch) {
+            resumed.fetch_add(1, std::memory_order_relaxed);
+            // Завершившаяся задача освобождает свой кадр сама (final_suspend)
+            handle.resume();
+        }
+        batch.clear();
+    }
+}
+
+void Scheduler::stop() {
+    std::lock_guard<std::mutex> stopLock(stopMutex);
+    {
+        // Флаг под мьютексами ожидания, чтобы ни один поток не проспал его
+        std::lock_guard<std::mutex> readyLock(readyMutex);
+        std::lock_guard<std::mutex> wheelLock(wheelMutex);
+        stopping = true;
+    }
+    readyCV.notify_all();
+    wheelCV.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    if (timerThread.joinable()) timerThread.join();
+
+    // Потоков больше нет: ждущих задач никто не разбудит, освобождаем кадры
+    for (std::coroutine_handle<> handle : ready) {
+        handle.destroy();
+    }
+    ready.clear();
+    for (auto& cell : wheel) {
+        for (const Timer& timer : cell) {
+            timer.handle.destroy();
+        }
+        cell.clear();
+    }
+    timerCount = 0;
+}
@@ -0,0 +1,213 @@
+#include "../include/snapshot.h"
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::uint64_t alignUp(std::uint64_t offset) {
+    return (offset + 7) & ~std::uint64_t(7);
+}
+
+// Файл, отображенный в память только для чтения.
+// Без mmap (Windows) файл просто читается целиком.
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> storage;
+#endif
+
+public:
+    explicit MappedFile(const std::string& filename) {
+#ifdef _WIN32
+        std::ifstream file(filename, std::ios::binary);
+        storage.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        bytes = storage.data();
+        length = storage.size();
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                bytes = static_cast<const char*>(mapped);
+                length = static_cast<size_t>(info.st_size);
+            }
+        }
+        // Отображение остается валидным и после закрытия дескриптора
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (bytes) {
+            ::munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Указатель на массив из count элементов, если он целиком внутри файла
+    template <typename T>
+    const T* array(std::uint64_t offset, std::uint64_t count) const {
+        if (offset % alignof(T) != 0 || offset > length || count > (length - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(bytes + offset);
+    }
+};
+
+template <typename T>
+void writeArray(std::ofstream& file, std::uint64_t offset, const T* data, size_t count) {
+    // Дополняем нулями до выровненного начала массива
+    static const char zeros[8] = {};
+    auto position = static_cast<std::uint64_t>(file.tellp());
+    file.write(zeros, static_cast<std::streamsize>(offset - position));
+    if (count > 0) {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+}
+
+} // namespace
+
+bool saveSnapshot(const NPCStore& store, const std::string& filename) {
+    const size_t count = store.size();
+
+    // В файл идут только встреченные имена, со своими номерами по порядку
+    std::vector<std::string> names;
+    std::vector<std::uint32_t> nameIndices(count);
+    std::unordered_map<std::uint32_t, std::uint32_t> localIndex;
+    const std::uint32_t* nameIds = store.nameIdData();
+    for (size_t i = 0; i < count; ++i) {
+        auto [it, inserted] = localIndex.emplace(nameIds[i], static_cast<std::uint32_t>(names.size()));
+        if (inserted) names.push_back(NameTable::global().name(nameIds[i]));
+        nameIndices[i] = it->second;
+    }
+
+    std::vector<std::uint64_t> nameOffsets;
+    nameOffsets.reserve(names.size() + 1);
+    std::uint64_t nameBytes = 0;
+    for (const auto& name : names) {
+        nameOffsets.push_back(nameBytes);
+        nameBytes += name.size();
+    }
+    nameOffsets.push_back(nameBytes);
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.count = count;
+    header.nameCount = names.size();
+    header.typesOffset = alignUp(sizeof(SnapshotHeader));
+    header.aliveOffset = alignUp(header.typesOffset + count);
+    header.xOffset = alignUp(header.aliveOffset + count);
+    header.yOffset = alignUp(header.xOffset + count * sizeof(double));
+    header.nameIndexOffset = alignUp(header.yOffset + count * sizeof(double));
+    header.idsOffset = alignUp(header.nameIndexOffset + count * sizeof(std::uint32_t));
+    header.nameOffsetsOffset = alignUp(header.idsOffset + count * sizeof(std::uint32_t));
+    header.nameBytesOffset = alignUp(header.nameOffsetsOffset + nameOffsets.size() * sizeof(std::uint64_t));
+    header.nameBytesSize = nameBytes;
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    static_assert(sizeof(NPCType) == 1, "тег типа хранится одним байтом");
+    writeArray(file, header.typesOffset, store.typeData(), count);
+    writeArray(file, header.aliveOffset, store.aliveData(), count);
+    writeArray(file, header.xOffset, store.xData(), count);
+    writeArray(file, header.yOffset, store.yData(), count);
+    writeArray(file, header.nameIndexOffset, nameIndices.data(), count);
+    writeArray(file, header.idsOffset, store.idData(), count);
+    writeArray(file, header.nameOffsetsOffset, nameOffsets.data(), nameOffsets.size());
+    writeArray(file, header.nameBytesOffset, static_cast<const char*>(nullptr), 0);
+    for (const auto& name : names) {
+        file.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool loadSnapshot(const std::string& filename, NPCStore& store) {
+    MappedFile file(filename);
+    if (!file.data() || file.size() < SNAPSHOT_V1_HEADER_SIZE) {
+        return false;
+    }
+
+    // Заголовок версии 1 короче, недостающие поля остаются нулями
+    SnapshotHeader headerData{};
+    std::memcpy(&headerData, file.data(), std::min(file.size(), sizeof(SnapshotHeader)));
+    const SnapshotHeader* header = &headerData;
+    if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version < 1 || header->version > SNAPSHOT_VERSION ||
+        (header->version >= 2 && file.size() < sizeof(SnapshotHeader))) {
+        return false;
+    }
+
+    const std::uint64_t count = header->count;
+    const auto* types = file.array<std::uint8_t>(header->typesOffset, count);
+    const auto* alive = file.array<std::uint8_t>(header->aliveOffset, count);
+    const auto* xs = file.array<double>(header->xOffset, count);
+    const auto* ys = file.array<double>(header->yOffset, count);
+    const auto* nameIndices = file.array<std::uint32_t>(header->nameIndexOffset, count);
+    const std::uint32_t* ids = nullptr;
+    if (header->version >= 2) {
+        ids = file.array<std::uint32_t>(header->idsOffset, count);
+        if (!ids) return false;
+    }
+    // Имен не больше, чем смещений влезает в файл; иначе nameCount + 1 мог бы переполниться
+    if (header->nameCount >= file.size() / sizeof(std::uint64_t)) return false;
+    const auto* nameOffsets = file.array<std::uint64_t>(header->nameOffsetsOffset, header->nameCount + 1);
+    const auto* nameBytes = file.array<char>(header->nameBytesOffset, header->nameBytesSize);
+    if (!types || !alive || !xs || !ys || !nameIndices || !nameOffsets || !nameBytes) {
+        return false;
+    }
+
+    // Проверяем то, что может вывести за границы массивов, и координаты:
+    // бесконечность или NaN сломали бы номер ячейки сетки
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (types[i] >= NPC_TYPE_COUNT || nameIndices[i] >= header->nameCount ||
+            !std::isfinite(xs[i]) || !std::isfinite(ys[i])) {
+            return false;
+        }
+    }
+
+    // Каждое имя файла вносится в общую таблицу один раз, прямо из отображения
+    std::vector<std::uint32_t> nameIds;
+    nameIds.reserve(header->nameCount);
+    for (std::uint64_t i = 0; i < header->nameCount; ++i) {
+        std::uint64_t begin = nameOffsets[i], end = nameOffsets[i + 1];
+        if (begin > end || end > header->nameBytesSize) return false;
+        nameIds.push_back(NameTable::global().intern(std::string_view(nameBytes + begin, end - begin)));
+    }
+
+    store.assignArrays(count, reinterpret_cast<const NPCType*>(types), alive, xs, ys, nameIndices, nameIds, ids);
+    return true;
+}
+
+bool isSnapshotFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
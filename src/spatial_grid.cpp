@@ -0,0 +1,129 @@
+#include "../include/spatial_grid.h"
+#include <cmath>
+
+SpatialGrid::SpatialGrid(double width, double height, double cellSize)
+    : width(width), height(height), cellSize(cellSize), cols(1), rows(1), count(0) {
+    resize(cellSize);
+}
+
+SpatialGrid::~SpatialGrid() {
+    clear();
+}
+
+// Ограничиваем до приведения к int: координата далеко за краем мира
+// (или NaN) иначе дала бы неопределенное поведение
+int SpatialGrid::cellX(double x) const {
+    double cx = std::floor(x / cellSize);
+    if (!(cx > 0)) return 0;
+    return cx < cols - 1 ? static_cast<int>(cx) : cols - 1;
+}
+
+int SpatialGrid::cellY(double y) const {
+    double cy = std::floor(y / cellSize);
+    if (!(cy > 0)) return 0;
+    return cy < rows - 1 ? static_cast<int>(cy) : rows - 1;
+}
+
+void SpatialGrid::resize(double newCellSize) {
+    reshape(width, height, newCellSize);
+}
+
+void SpatialGrid::reshape(double newWidth, double newHeight, double newCellSize) {
+    // Собираем все NPC, чтобы разложить их по новым ячейкам
+    std::vector<NPC*> all;
+    all.reserve(count);
+    for (auto& cell : cells) {
+        all.insert(all.end(), cell.begin(), cell.end());
+    }
+
+    width = newWidth;
+    height = newHeight;
+    cellSize = newCellSize > 0 ? newCellSize : 1.0;
+    // В огромном мире с маленькими дистанциями ячеек было бы больше, чем
+    // помещается в память: укрупняем их, поиск в радиусе от этого не ломается
+    auto cellCount = [this]() {
+        return std::max(1.0, std::ceil(width / cellSize)) * std::max(1.0, std::ceil(height / cellSize));
+    };
+    if (cellCount() > MAX_CELLS) {
+        cellSize = std::max(cellSize, std::sqrt(width * height / MAX_CELLS));
+        while (cellCount() > MAX_CELLS) {
+            cellSize *= 1.5;
+        }
+    }
+    cols = std::max(1, static_cast<int>(std::ceil(width / cellSize)));
+    rows = std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+    cells.assign(static_cast<size_t>(cols) * rows, {});
+    cellXs.assign(cells.size(), {});
+    cellYs.assign(cells.size(), {});
+
+    for (NPC* npc : all) {
+        addToCell(npc, cellIndex(npc->x, npc->y));
+    }
+}
+
+void SpatialGrid::addToCell(NPC* npc, int cell) {
+    npc->gridCell = cell;
+    npc->gridSlot = cells[cell].size();
+    cells[cell].push_back(npc);
+    cellXs[cell].push_back(npc->x);
+    cellYs[cell].push_back(npc->y);
+}
+
+void SpatialGrid::removeFromCell(NPC* npc) {
+    // Удаление за O(1): последний элемент ячейки встает на место удаляемого
+    auto& cell = cells[npc->gridCell];
+    auto& xs = cellXs[npc->gridCell];
+    auto& ys = cellYs[npc->gridCell];
+    NPC* last = cell.back();
+    cell[npc->gridSlot] = last;
+    xs[npc->gridSlot] = xs.back();
+    ys[npc->gridSlot] = ys.back();
+    last->gridSlot = npc->gridSlot;
+    cell.pop_back();
+    xs.pop_back();
+    ys.pop_back();
+    npc->gridCell = -1;
+}
+
+void SpatialGrid::insert(NPC* npc) {
+    if (npc->grid == this) return;
+    if (npc->grid) npc->grid->remove(npc);
+
+    npc->grid = this;
+    addToCell(npc, cellIndex(npc->x, npc->y));
+    count++;
+}
+
+void SpatialGrid::remove(NPC* npc) {
+    if (npc->grid != this) return;
+
+    removeFromCell(npc);
+    npc->grid = nullptr;
+    count--;
+}
+
+void SpatialGrid::update(NPC* npc) {
+    if (npc->grid != this) return;
+
+    int cell = cellIndex(npc->x, npc->y);
+    if (cell != npc->gridCell) {
+        removeFromCell(npc);
+        addToCell(npc, cell);
+    } else {
+        cellXs[cell][npc->gridSlot] = npc->x;
+        cellYs[cell][npc->gridSlot] = npc->y;
+    }
+}
+
+void SpatialGrid::clear() {
+    for (auto& cell : cells) {
+        for (NPC* npc : cell) {
+            npc->grid = nullptr;
+            npc->gridCell = -1;
+        }
+        cell.clear();
+    }
+    for (auto& xs : cellXs) xs.clear();
+    for (auto& ys : cellYs) ys.clear();
+    count = 0;
+}
@@ -0,0 +1,81 @@
+#include "../include/thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t workers)
+    : job(nullptr), jobCount(0), jobChunks(0), generation(0), pending(0), stopping(false) {
+    size_t background = workers > 1 ? workers - 1 : 0;
+    threads.reserve(background);
+    for (size_t i = 0; i < background; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCV.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::runChunk(size_t chunk) {
+    size_t begin = jobCount * chunk / jobChunks;
+    size_t end = jobCount * (chunk + 1) / jobChunks;
+    (*job)(begin, end, chunk);
+}
+
+void ThreadPool::workerLoop(size_t worker) {
+    size_t seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCV.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            // Участков может быть меньше, чем потоков
+            if (worker >= jobChunks) continue;
+        }
+
+        runChunk(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                doneCV.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t minChunk, const RangeFn& fn) {
+    if (count == 0) return;
+
+    size_t chunks = std::max<size_t>(1, count / std::max<size_t>(1, minChunk));
+    chunks = std::min(chunks, size());
+
+    if (chunks == 1) {
+        fn(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        jobChunks = chunks;
+        pending = chunks - 1;
+        generation++;
+    }
+    startCV.notify_all();
+
+    // Нулевой участок выполняет вызывающий поток
+    runChunk(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCV.wait(lock, [&]() { return pending == 0; });
+    job = nullptr;
+}
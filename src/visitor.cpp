@@ -4,7 +4,7 @@ void Visitor::addObserver(std::shared_ptr<Observer> observer) {
     observers.push_back(observer);
 }
 
-void Visitor::notifyObservers(const std::string& attacker, const std::string& defender, bool defenderDied) {
+void Visitor::notifyObservers(NPCRef attacker, NPCRef defender, bool defenderDied) {
     for (auto& observer : observers) {
         observer->onFight(attacker, defender, defenderDied);
     }
@@ -15,19 +15,21 @@ void Visitor::notifyObservers(const std::string& attacker, const std::string& de
 // Бык толчет жаб
 // Жабы спасаются как могут (никого не убивают)
 
+// Законность боя проверяется по таблице атак (npc.h), без dynamic_cast
+
 void Visitor::visit(Dragon& dragon, NPC& other) {
-    if (auto bull = dynamic_cast<Bull*>(&other)) {
-        notifyObservers(dragon.getName(), bull->getName(), true);
+    if (dragon.canAttack(&other)) {
+        notifyObservers(dragon.ref(), other.ref(), true);
     }
 }
 
 void Visitor::visit(Bull& bull, NPC& other) {
-    if (auto toad = dynamic_cast<Toad*>(&other)) {
-        notifyObservers(bull.getName(), toad->getName(), true);
+    if (bull.canAttack(&other)) {
+        notifyObservers(bull.ref(), other.ref(), true);
     }
 }
 
 void Visitor::visit(Toad& toad, NPC& other) {
     // Жабы никого не убивают
-    notifyObservers(toad.getName(), other.getName(), false);
-}
\ No newline at end of file
+    notifyObservers(toad.ref(), other.ref(), false);
+}
@@ -0,0 +1,171 @@
+#include "../include/world_config.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+namespace {
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool parseDouble(const std::string& text, double& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtod(text.c_str(), &end);
+    return errno == 0 && *end == '\0';
+}
+
+bool parseInt(const std::string& text, long long min, long long max, long long& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return errno == 0 && *end == '\0' && value >= min && value <= max;
+}
+
+} // namespace
+
+WorldConfig::WorldConfig() {
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        typeMix[i] = 1;
+        moveDistance[i] = NPC_TYPE_INFO[i].moveDistance;
+        killDistance[i] = NPC_TYPE_INFO[i].killDistance;
+    }
+}
+
+int WorldConfig::getMaxKillDistance() const {
+    return *std::max_element(killDistance.begin(), killDistance.end());
+}
+
+bool WorldConfig::set(const std::string& key, const std::string& value, std::string& error) {
+    const std::string text = trim(value);
+    double number = 0;
+    long long integer = 0;
+
+    if (key == "width" || key == "height") {
+        if (!parseDouble(text, number) || !(number > 0) || !std::isfinite(number)) {
+            error = key + ": нужно конечное положительное число, получено '" + text + "'";
+            return false;
+        }
+        (key == "width" ? width : height) = number;
+        return true;
+    }
+    if (key == "npcs") {
+        if (!parseInt(text, 0, std::numeric_limits<long long>::max(), integer)) {
+            error = "npcs: нужно целое неотрицательное число, получено '" + text + "'";
+            return false;
+        }
+        spawnCount = static_cast<size_t>(integer);
+        return true;
+    }
+    if (key == "map.columns" || key == "map.rows") {
+        if (!parseInt(text, 1, 1000, integer)) {
+            error = key + ": нужно целое от 1 до 1000, получено '" + text + "'";
+            return false;
+        }
+        (key == "map.columns" ? mapColumns : mapRows) = static_cast<int>(integer);
+        return true;
+    }
+
+    // Ключи по типам: mix.Dragon, move.Bull, kill.Toad
+    size_t dot = key.find('.');
+    NPCType type;
+    if (dot != std::string::npos && npcTypeFromName(key.substr(dot + 1), type)) {
+        const std::string group = key.substr(0, dot);
+        const size_t index = static_cast<size_t>(type);
+        if (group == "mix") {
+            if (!parseDouble(text, number) || !(number >= 0) || !std::isfinite(number)) {
+                error = key + ": нужна конечная неотрицательная доля, получено '" + text + "'";
+                return false;
+            }
+            typeMix[index] = number;
+            return true;
+        }
+        if (group == "move" || group == "kill") {
+            if (!parseInt(text, 0, 1000000, integer)) {
+                error = key + ": нужно целое от 0 до 1000000, получено '" + text + "'";
+                return false;
+            }
+            (group == "move" ? moveDistance : killDistance)[index] = static_cast<int>(integer);
+            return true;
+        }
+    }
+
+    error = "неизвестный параметр мира '" + key + "'";
+    return false;
+}
+
+bool WorldConfig::set(const std::string& assignment, std::string& error) {
+    size_t equals = assignment.find('=');
+    if (equals == std::string::npos) {
+        error = "ожидалось ключ=значение, получено '" + assignment + "'";
+        return false;
+    }
+    return set(trim(assignment.substr(0, equals)), assignment.substr(equals + 1), error);
+}
+
+bool WorldConfig::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        if (!set(line, error)) {
+            error = path + ":" + std::to_string(number) + ": " + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WorldConfig::validate(std::string& error) const {
+    if (!(width > 0) || !(height > 0) || !std::isfinite(width) || !std::isfinite(height)) {
+        error = "размеры мира (width, height) должны быть конечными положительными числами";
+        return false;
+    }
+    double totalMix = 0;
+    for (double weight : typeMix) {
+        totalMix += weight;
+    }
+    if (spawnCount > 0 && !(totalMix > 0)) {
+        error = "доли типов (mix.*) не могут быть все нулевыми";
+        return false;
+    }
+    // Каждая доля конечна, но их сумма еще может переполниться
+    if (!std::isfinite(totalMix)) {
+        error = "доли типов (mix.*) должны быть конечными, как и их сумма";
+        return false;
+    }
+    if (getMaxKillDistance() <= 0) {
+        error = "хотя бы одна дистанция убийства (kill.*) должна быть больше нуля";
+        return false;
+    }
+    return true;
+}
+
+void WorldConfig::save(std::ostream& os) const {
+    os << "width = " << width << "\n"
+       << "height = " << height << "\n"
+       << "npcs = " << spawnCount << "\n";
+    for (size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        const char* name = NPC_TYPE_INFO[i].name;
+        os << "mix." << name << " = " << typeMix[i] << "\n"
+           << "move." << name << " = " << moveDistance[i] << "\n"
+           << "kill." << name << " = " << killDistance[i] << "\n";
+    }
+    os << "map.columns = " << mapColumns << "\n"
+       << "map.rows = " << mapRows << "\n";
+}
@@ -0,0 +1,66 @@
+#include "../include/world_snapshot.h"
+#include <atomic>
+#include <thread>
+
+WorldSnapshotBuffer::WorldSnapshotBuffer() : current(0), epoch(0), allocations(0) {
+    for (auto& count : pinned) {
+        count.store(0);
+    }
+    buffers[0] = std::make_shared<WorldSnapshot>();
+}
+
+size_t WorldSnapshotBuffer::acquireFree() {
+    // Номер текущего меняет только писатель, а он держит writerMutex
+    const size_t active = current.load(std::memory_order_relaxed);
+
+    // use_count() == 1: ссылается только таблица. Новых ссылок на такой
+    // буфер появиться не может - читатель копирует только отмеченный
+    // текущий буфер, а этот не текущий и не отмечен
+    for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+        if (i != active && buffers[i] && pinned[i].load() == 0 && buffers[i].use_count() == 1) {
+            // use_count читается relaxed: без барьера запись в буфер могла бы
+            // обогнать последние чтения читателя, только что отпустившего его
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return i;
+        }
+    }
+    for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+        if (!buffers[i]) {
+            buffers[i] = std::make_shared<WorldSnapshot>();
+            allocations++;
+            return i;
+        }
+    }
+
+    // Все буферы заняты читателями: заменяем самый старый, не текущий.
+    // Отметка на нем держится несколько инструкций - читатель увидит,
+    // что буфер не текущий, и снимет ее
+    size_t oldest = BUFFER_COUNT;
+    for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+        if (i == active) continue;
+        if (oldest == BUFFER_COUNT || buffers[i]->epoch < buffers[oldest]->epoch) {
+            oldest = i;
+        }
+    }
+    while (pinned[oldest].load() != 0) {
+        std::this_thread::yield();
+    }
+    buffers[oldest] = std::make_shared<WorldSnapshot>();
+    allocations++;
+    return oldest;
+}
+
+std::shared_ptr<const WorldSnapshot> WorldSnapshotBuffer::acquire() const {
+    while (true) {
+        size_t index = current.load();
+        pinned[index].fetch_add(1);
+        // Отметка видна писателю раньше, чем мы перечитали номер: если буфер
+        // все еще текущий, писатель его не возьмет, пока отметка не снята
+        if (current.load() == index) {
+            std::shared_ptr<const WorldSnapshot> result = buffers[index];
+            pinned[index].fetch_sub(1);
+            return result;
+        }
+        pinned[index].fetch_sub(1);
+    }
+}
@@ -0,0 +1,249 @@
+// Эталонный прогон воспроизводимого режима: зерно 7, 5000 NPC, 200 тиков.
+// Контрольная сумма не должна зависеть от числа потоков и хранилища NPC,
+// от перерыва с продолжением из контрольной точки (вместе со счетчиками)
+// и от повтора по журналу. Один регион (region.h) дает тот же мир, а
+// несколько регионов не теряют и не удваивают NPC на границах.
+// Без воспроизводимого режима точку догоняет журнал прогона.
+// Использование: determinism_test threads N | columns | resume | resume-log | replay | regions N
+#include "../include/dungeon.h"
+#include "../include/region.h"
+#include "../include/replay.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+const unsigned SEED = 7;
+const size_t NPC_COUNT = 5000;
+const std::uint64_t TICKS = 200;
+// Меняется вместе с правилами хода, боя или генераторами чисел
+const std::uint64_t GOLDEN_CHECKSUM = 0xfb9002ec01b7802eull;
+
+// Подземелье как у dungeon_simulator --deterministic --seed 7 --npcs 5000
+void configure(Dungeon& dungeon, size_t threads, NPCStorage storage = NPCStorage::Objects) {
+    WorldConfig world;
+    world.spawnCount = NPC_COUNT;
+    dungeon.setSeed(SEED);
+    dungeon.setDeterministic(true);
+    dungeon.setMovementThreads(threads);
+    dungeon.setStorage(storage);
+    dungeon.setWorldConfig(world);
+}
+
+std::string temporaryPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / (name + "." + std::to_string(::getpid()))).string();
+}
+
+bool expectChecksum(const std::string& what, std::uint64_t actual, std::uint64_t expected) {
+    if (actual == expected) return true;
+    std::cerr << what << ": контрольная сумма " << std::hex << actual << ", ожидалась " << expected << std::dec
+              << "\n";
+    return false;
+}
+
+std::uint64_t runFresh(size_t threads, std::uint64_t ticks, NPCStorage storage = NPCStorage::Objects) {
+    Dungeon dungeon;
+    configure(dungeon, threads, storage);
+    dungeon.spawnRandomNPCs(NPC_COUNT);
+    return dungeon.runHeadless(ticks).checksum;
+}
+
+bool testThreads(size_t threads) {
+    return expectChecksum("потоков " + std::to_string(threads), runFresh(threads, TICKS), GOLDEN_CHECKSUM);
+}
+
+bool testColumns() {
+    return expectChecksum("хранилище столбцами", runFresh(4, TICKS, NPCStorage::Columns), GOLDEN_CHECKSUM);
+}
+
+// Счетчики продолженного прогона должны совпасть со сплошным
+bool expectStats(const StatsSnapshot& actual, const StatsSnapshot& expected) {
+    bool same = actual.total == expected.total && actual.alive == expected.alive &&
+                actual.fights == expected.fights && actual.killsByPair == expected.killsByPair &&
+                actual.compacted == expected.compacted &&
+                actual.deathsHistorySize == expected.deathsHistorySize &&
+                actual.deathsHistory == expected.deathsHistory;
+    if (!same) {
+        std::cerr << "счетчики: боев " << actual.fights << " / " << expected.fights << ", убрано "
+                  << actual.compacted << " / " << expected.compacted << ", живых " << actual.alive << " / "
+                  << expected.alive << ", тиков в истории смертей " << actual.deathsHistorySize << " / "
+                  << expected.deathsHistorySize << "\n";
+    }
+    return same;
+}
+
+// Половина прогона, остановка с последней точкой, продолжение в новом
+// подземелье. С уплотнением, чтобы точка переносила и его счетчик
+bool testResume() {
+    const std::string path = temporaryPath("determinism_test.ckp");
+    Dungeon whole;
+    configure(whole, 2);
+    whole.setCompaction(0.05, 64);
+    whole.spawnRandomNPCs(NPC_COUNT);
+    const std::uint64_t expected = whole.runHeadless(TICKS).checksum;
+    {
+        Dungeon first;
+        configure(first, 2);
+        first.setCompaction(0.05, 64);
+        first.spawnRandomNPCs(NPC_COUNT);
+        first.enableCheckpoints(path, 50);
+        first.runHeadless(TICKS / 2);
+    }
+
+    Dungeon second;
+    configure(second, 2);
+    second.setCompaction(0.05, 64);
+    bool ok = second.resumeFromCheckpoint(path);
+    if (!ok) {
+        std::cerr << "не удалось прочитать " << path << "\n";
+    } else {
+        ok = expectChecksum("продолжение с тика " + std::to_string(second.getTick()),
+                            second.runHeadless(TICKS - TICKS / 2).checksum, expected);
+        ok = expectStats(second.getStats(), whole.getStats()) && ok;
+    }
+    std::filesystem::remove(path);
+    return ok;
+}
+
+// Обычный режим: точка на середине прогона, дальше только журнал.
+// Продолжение по точке и журналу должно дать мир и счетчики на конец записи
+bool testResumeLog() {
+    const std::string checkpointPath = temporaryPath("determinism_test_log.ckp");
+    const std::string stalePath = temporaryPath("determinism_test_stale.ckp");
+    const std::string logPath = temporaryPath("determinism_test_log.bin");
+    std::uint64_t expected = 0;
+    StatsSnapshot expectedStats;
+    {
+        FileLogConfig log;
+        log.path = logPath;
+        log.format = FileLogConfig::Format::Binary;
+        log.bufferSize = 1 << 20;
+        log.truncate = true;
+
+        Dungeon dungeon;
+        configure(dungeon, 2);
+        dungeon.setDeterministic(false);
+        dungeon.setCompaction(0.05, 64);
+        dungeon.addObserver(std::make_shared<FileObserver>(log));
+        dungeon.setRecording(true);
+        dungeon.spawnRandomNPCs(NPC_COUNT);
+        dungeon.enableCheckpoints(checkpointPath, 50);
+        dungeon.runHeadless(TICKS / 2);
+        // Дальше точки идут в другой файл: первая остается на тике TICKS / 2
+        dungeon.enableCheckpoints(stalePath, TICKS);
+        dungeon.runHeadless(TICKS / 2);
+        expected = dungeon.stateChecksum();
+        expectedStats = dungeon.getStats();
+    }
+
+    Dungeon second;
+    configure(second, 2);
+    bool ok = second.resumeFromCheckpoint(checkpointPath, logPath);
+    if (!ok) {
+        std::cerr << "не удалось продолжить с " << checkpointPath << " по журналу " << logPath << "\n";
+    } else {
+        ok = second.getTick() == TICKS;
+        if (!ok) std::cerr << "продолжение с тика " << second.getTick() << ", ожидался " << TICKS << "\n";
+        ok = expectChecksum("точка с журналом", second.stateChecksum(), expected) && ok;
+        ok = expectStats(second.getStats(), expectedStats) && ok;
+    }
+    std::filesystem::remove(checkpointPath);
+    std::filesystem::remove(stalePath);
+    std::filesystem::remove(logPath);
+    return ok;
+}
+
+// Запись прогона и восстановление мира по журналу на середину и на конец
+bool testReplay() {
+    const std::string path = temporaryPath("determinism_test.bin");
+    std::uint64_t recorded = 0;
+    {
+        FileLogConfig log;
+        log.path = path;
+        log.format = FileLogConfig::Format::Binary;
+        log.bufferSize = 1 << 20;
+        log.truncate = true;
+
+        Dungeon dungeon;
+        configure(dungeon, 2);
+        dungeon.addObserver(std::make_shared<FileObserver>(log));
+        dungeon.setRecording(true);
+        dungeon.spawnRandomNPCs(NPC_COUNT);
+        recorded = dungeon.runHeadless(TICKS).checksum;
+    }
+
+    ReplayEngine replay(25);
+    bool ok = expectChecksum("записанный прогон", recorded, GOLDEN_CHECKSUM);
+    if (!replay.open(path)) {
+        std::cerr << "не удалось открыть журнал " << path << "\n";
+        ok = false;
+    } else {
+        ok = replay.seek(TICKS / 2) &&
+             expectChecksum("повтор до тика " + std::to_string(TICKS / 2), replay.getState().checksum(),
+                            runFresh(1, TICKS / 2)) &&
+             ok;
+        ok = replay.seek(TICKS) &&
+             expectChecksum("повтор до тика " + std::to_string(TICKS), replay.getState().checksum(), GOLDEN_CHECKSUM) &&
+             ok;
+    }
+    std::filesystem::remove(path);
+    return ok;
+}
+
+// Мир в процессах регионов. Один регион - эталонный прогон; для
+// нескольких мир шире, чтобы полоса вмещала ход и удар
+bool testRegions(size_t regions) {
+    RegionConfig config;
+    config.world.spawnCount = NPC_COUNT;
+    if (regions > 1) config.world.width = 200.0 * regions;
+    config.regions = regions;
+    config.ticks = TICKS;
+    config.seeded = true;
+    config.seed = SEED;
+    config.deterministic = true;
+    config.compactDeadFraction = 0;
+
+    RegionReport report;
+    std::string error;
+    if (!runRegions(config, report, error)) {
+        std::cerr << "регионов " << regions << ": " << error << "\n";
+        return false;
+    }
+    bool ok = report.total == NPC_COUNT;
+    if (!ok) {
+        std::cerr << "регионов " << regions << ": NPC в конце " << report.total << ", ожидалось " << NPC_COUNT
+                  << "\n";
+    }
+    if (regions == 1) {
+        ok = expectChecksum("один регион", report.checksum, GOLDEN_CHECKSUM) && ok;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::string mode = argc > 1 ? argv[1] : "";
+    bool ok;
+    if (mode == "threads" && argc > 2) {
+        ok = testThreads(std::stoull(argv[2]));
+    } else if (mode == "columns") {
+        ok = testColumns();
+    } else if (mode == "resume") {
+        ok = testResume();
+    } else if (mode == "resume-log") {
+        ok = testResumeLog();
+    } else if (mode == "replay") {
+        ok = testReplay();
+    } else if (mode == "regions" && argc > 2) {
+        ok = testRegions(std::stoull(argv[2]));
+    } else {
+        std::cerr << "Использование: " << argv[0] << " threads N | columns | resume | resume-log | replay | regions N\n";
+        return 2;
+    }
+    std::cout << mode << (ok ? ": OK" : ": ОШИБКА") << std::endl;
+    return ok ? 0 : 1;
+}
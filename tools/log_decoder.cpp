@@ -0,0 +1,39 @@
+// Переводит двоичный журнал FileObserver обратно в текстовый формат.
+// Использование: log_decoder <журнал.bin> [выход.txt]
+#include "../include/event_log.h"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Использование: " << argv[0] << " <журнал.bin> [выход.txt]\n";
+        return 1;
+    }
+
+    EventLogReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Ошибка: " << argv[1] << " не является двоичным журналом\n";
+        return 1;
+    }
+
+    std::ofstream outFile;
+    if (argc >= 3) {
+        outFile.open(argv[2]);
+        if (!outFile) {
+            std::cerr << "Ошибка: не удалось открыть " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = argc >= 3 ? outFile : std::cout;
+
+    LogRecord record;
+    size_t events = 0;
+    while (reader.next(record)) {
+        if (record.type == LogRecord::Type::Name) continue;
+        reader.writeText(out, record);
+        events++;
+    }
+
+    std::cerr << "Декодировано событий: " << events << "\n";
+    return 0;
+}
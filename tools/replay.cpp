@@ -0,0 +1,101 @@
+// Восстанавливает мир записанного прогона на заданные тики.
+// Использование: dungeon_replay <журнал.bin> [--interval K] [--keyframe-mb M] [--tick N]... [--save файл]
+// Журнал пишет dungeon_simulator --record <журнал.bin>.
+#include "../include/replay.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Использование: " << program << " <журнал.bin> [параметры]\n"
+              << "  --interval K  тиков между ключевыми кадрами (100)\n"
+              << "  --keyframe-mb M  предел памяти ключевых кадров, МБ (256); при\n"
+              << "                превышении кадры прореживаются\n"
+              << "  --tick N      показать мир на конец тика N (можно несколько раз;\n"
+              << "                без этого параметра - последний тик)\n"
+              << "  --save F      сохранить живых NPC последнего тика в F (формат saveToFile)\n";
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printState(const ReplayState& state) {
+    std::cout << "Тик " << state.tick << ": живых " << state.getAliveCount() << " из " << state.getNPCCount()
+              << " (";
+    for (size_t type = 0; type < NPC_TYPE_COUNT; ++type) {
+        if (type > 0) std::cout << ", ";
+        std::cout << NPC_TYPE_INFO[type].name << " " << state.getAliveCount(static_cast<NPCType>(type));
+    }
+    std::cout << "), боев " << state.fights << ", контрольная сумма " << std::hex << state.checksum()
+              << std::dec << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string logPath = argv[1];
+    std::uint64_t interval = 100;
+    size_t keyframeBudget = ReplayEngine::DEFAULT_KEYFRAME_BUDGET;
+    std::vector<std::uint64_t> ticks;
+    std::string savePath;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--interval" && hasValue) {
+            interval = std::stoull(argv[++i]);
+        } else if (arg == "--keyframe-mb" && hasValue) {
+            keyframeBudget = static_cast<size_t>(std::stoull(argv[++i])) << 20;
+        } else if (arg == "--tick" && hasValue) {
+            ticks.push_back(std::stoull(argv[++i]));
+        } else if (arg == "--save" && hasValue) {
+            savePath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ReplayEngine replay(interval, keyframeBudget);
+    auto start = std::chrono::steady_clock::now();
+    if (!replay.open(logPath)) {
+        std::cerr << "Ошибка: " << logPath << " не является записью прогона (нужен --record)\n";
+        return 1;
+    }
+    std::cerr << "Индекс: тики " << replay.getFirstTick() << "-" << replay.getLastTick() << ", ключевых кадров "
+              << replay.getKeyframeCount() << " (" << replay.getKeyframeBytes() / 1024 << " КБ, через "
+              << replay.getKeyframeInterval() << " тиков), " << elapsedMs(start) << " мс\n";
+
+    if (ticks.empty()) {
+        ticks.push_back(replay.getLastTick());
+    }
+    for (std::uint64_t tick : ticks) {
+        start = std::chrono::steady_clock::now();
+        if (!replay.seek(tick)) {
+            std::cerr << "Тик " << tick << " вне записи\n";
+            continue;
+        }
+        printState(replay.getState());
+        std::cerr << "  прочитано записей: " << replay.getRecordsRead() << ", " << elapsedMs(start) << " мс\n";
+    }
+
+    if (!savePath.empty()) {
+        std::ofstream file(savePath);
+        for (const auto& npc : replay.getState().world()) {
+            if (value::body(npc).alive) {
+                value::save(file, npc);
+                file << "\n";
+            }
+        }
+    }
+    return 0;
+}